@@ -88,6 +88,13 @@ Result ryuldnSetLoggingLevel(RyuLdnConfigService *srv, u32 level) {
     return serviceDispatchIn(&srv->s, 65013, level);
 }
 
+Result ryuldnGetSocketStats(RyuLdnConfigService *srv, RyuLdnSocketStats *stats, size_t max_count, u32 *count) {
+    return serviceDispatchOut(&srv->s, 65014, *count,
+        .buffer_attrs = { SfBufferAttr_HipcMapAlias | SfBufferAttr_Out },
+        .buffers = { { stats, max_count * sizeof(RyuLdnSocketStats) } },
+    );
+}
+
 void ryuldnConfigCleanup() {
     // Nothing to do - service will be closed by caller
 }
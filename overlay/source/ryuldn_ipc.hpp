@@ -45,6 +45,26 @@ struct RyuLdnStatus {
     int64_t ping_ms;
 };
 
+// Traffic counters of one virtual socket; addresses in host byte order
+struct RyuLdnSocketStats {
+    uint32_t local_ip;
+    uint16_t local_port;
+    uint8_t protocol;            // 6 = TCP, 17 = UDP
+    uint8_t slow_consumer;
+    uint32_t remote_ip;
+    uint16_t remote_port;
+    uint16_t _reserved;
+    uint64_t packets_in;
+    uint64_t bytes_in;
+    uint64_t packets_out;
+    uint64_t bytes_out;
+    uint32_t queue_bytes;
+    uint32_t queue_high_water;
+    uint32_t receive_drops;
+    uint32_t backlog_drops;
+    int64_t ms_since_last_read;  // -1 = never read
+};
+
 struct RyuLdnConfig {
     uint32_t enabled;  // 0=disabled, 1=enabled
     char server_ip[16];
@@ -68,6 +88,7 @@ enum RyuLdnConfigCmd : uint32_t {
     RyuLdnConfigCmd_SetServerPort    = 65011,
     RyuLdnConfigCmd_GetLoggingLevel  = 65012,
     RyuLdnConfigCmd_SetLoggingLevel  = 65013,
+    RyuLdnConfigCmd_GetSocketStats   = 65014,
 };
 
 // Validate struct sizes for IPC consistency
@@ -76,6 +97,7 @@ static_assert(sizeof(RyuLdnConfig) == 72, "RyuLdnConfig size mismatch");
 static_assert(sizeof(RyuLdnVersion) == 32, "RyuLdnVersion size mismatch");
 static_assert(sizeof(RyuLdnPassphrase) == 17, "RyuLdnPassphrase size mismatch");
 static_assert(sizeof(RyuLdnServerIP) == 16, "RyuLdnServerIP size mismatch");
+static_assert(sizeof(RyuLdnSocketStats) == 72, "RyuLdnSocketStats size mismatch");
 
 
 /* ===== RYULDN CONFIG SERVICE ===== */
@@ -102,6 +124,8 @@ Result ryuldnGetServerPort(RyuLdnConfigService *srv, u16 *port);
 Result ryuldnSetServerPort(RyuLdnConfigService *srv, u16 port);
 Result ryuldnGetLoggingLevel(RyuLdnConfigService *srv, u32 *level);
 Result ryuldnSetLoggingLevel(RyuLdnConfigService *srv, u32 level);
+// Fills up to max_count entries, one per open virtual socket
+Result ryuldnGetSocketStats(RyuLdnConfigService *srv, RyuLdnSocketStats *stats, size_t max_count, u32 *count);
 
 // Cleanup
 void ryuldnConfigCleanup();
@@ -0,0 +1,71 @@
+// Counts every heap allocation so the benchmark can report allocations per command
+#include "bench.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+    thread_local u64 t_allocations = 0;
+    std::atomic<u64> g_allocations{0};
+
+    void* CountedAlloc(size_t size) {
+        t_allocations++;
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        return std::malloc(size != 0 ? size : 1);
+    }
+
+    void* CountedAlignedAlloc(size_t size, std::align_val_t align) {
+        t_allocations++;
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        const size_t alignment = static_cast<size_t>(align);
+        return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    }
+
+}
+
+namespace bench {
+
+    u64 GetThreadAllocations() { return t_allocations; }
+    u64 GetTotalAllocations() { return g_allocations.load(std::memory_order_relaxed); }
+
+}
+
+void* operator new(size_t size) {
+    if (void* p = CountedAlloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size);
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+    if (void* p = CountedAlignedAlloc(size, align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t align) {
+    return operator new(size, align);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { std::free(p); }
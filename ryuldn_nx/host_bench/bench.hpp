@@ -0,0 +1,31 @@
+#pragma once
+// Host benchmark of the bsd:u mitm command path
+// Pieces shared by the driver, the mock bsd service and the stubs
+
+#include <switch.h>
+
+namespace bench {
+
+    // Heap allocations made through operator new (alloc_count.cpp)
+    u64 GetThreadAllocations();
+    u64 GetTotalAllocations();
+
+    // Outbound traffic the stub master client would have written to the relay server
+    u64 GetRelayPackets();
+    u64 GetRelayBytes();
+
+    namespace mock_bsd {
+
+        // Busy time spent in every request that reaches the mock, standing in for the IPC round trip
+        void SetForwardCost(u64 ns);
+
+        // What the mitm framework does when a handler returns ResultShouldForwardToSession:
+        // replay the untouched request against bsd (fd is the socket it names, -1 for none)
+        void ForwardSession(u32 command_id, s32 fd);
+
+        u64 GetDispatchCount();   // Requests the handlers sent to bsd themselves (Socket, Close, merged Select/Poll)
+        u64 GetForwardCount();    // Requests handed back whole
+
+    }
+
+}
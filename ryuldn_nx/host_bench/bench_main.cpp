@@ -0,0 +1,637 @@
+// Host benchmark of the bsd:u mitm command handlers
+// Replays game-like syscall mixes against BsdMitmService on several threads and reports
+// throughput, latency percentiles and heap allocations per command
+#include "bench.hpp"
+#include "../source/bsd_mitm_service.hpp"
+#include "../source/ryuldn/proxy/ldn_proxy_socket.hpp"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    using namespace ams;
+    using ams::mitm::ldn::BsdMitmService;
+    namespace ryuldn = ams::mitm::ldn::ryuldn;
+
+    constexpr u32 LocalIp = 0x0A720001;      // 10.114.0.1, this console
+    constexpr u32 PeerIp = 0x0A720002;       // 10.114.0.2, a player behind the relay
+    constexpr u32 SubnetMask = 0xFFFF0000;
+    constexpr u16 PeerPort = 7000;
+    constexpr u16 FirstPort = 40000;
+    constexpr u16 PortsPerThread = 16;
+
+    // nn::socket (FreeBSD) fcntl encodings, as games send them
+    constexpr s32 BsdFcntlSetFl = 4;
+    constexpr s32 BsdNonBlock = 0x0004;
+
+    constexpr u32 CmdSocket = 2, CmdSelect = 5, CmdPoll = 6, CmdRecv = 8, CmdRecvFrom = 9, CmdSend = 10,
+                  CmdSendTo = 11, CmdGetSockOpt = 17, CmdClose = 26;
+
+    enum Op : u8 {
+        Op_Select, Op_Poll, Op_RecvFrom, Op_SendTo, Op_Recv, Op_Send, Op_GetSockOpt, Op_Socket, Op_Close,
+        Op_Count
+    };
+    constexpr const char* OpNames[Op_Count] = {
+        "Select", "Poll", "RecvFrom", "SendTo", "Recv", "Send", "GetSockOpt", "Socket", "Close"
+    };
+
+    struct Options {
+        u32 threads = 4;
+        u32 ops = 200000;            // Per thread
+        u32 payload = 128;           // Bytes per datagram
+        u64 forward_ns = 0;          // Cost of one request reaching bsd
+        u32 log_level = 0;
+        double tolerance = 10.0;     // Percent of ops/sec a gated run may lose
+        std::string workload = "all";
+        std::string baseline;
+    };
+
+    struct ThreadStats {
+        std::vector<u32> latency[Op_Count];   // Nanoseconds, one entry per call
+        u64 allocations[Op_Count] = {};
+        u64 failures = 0;                     // Calls answered with ret < 0 other than EAGAIN
+        u64 received = 0;                     // Datagrams RecvFrom returned
+
+        void Reserve(size_t count) {
+            for (auto& samples : latency) {
+                samples.reserve(count);
+            }
+        }
+    };
+
+    // Stands in for the master client: its worker thread fires the proxy's timers, and Deliver() pushes
+    // ProxyData frames from the remote player through the protocol, the way a read from the relay
+    // server would. Game threads call Deliver() between their own commands, so every run replays the
+    // same arrivals whatever the host's core count.
+    class Relay {
+    private:
+        ryuldn::LdnMasterProxyClient& _master;
+        std::vector<std::vector<u8>> _streams;   // One read's worth of frames per game thread
+        std::mutex _readMutex;                   // The protocol is fed by one reader at a time
+        std::atomic<bool> _stop{false};
+        std::thread _thread;
+
+        void Run() {
+            auto& timers = _master.GetTimers();
+            while (!_stop.load(std::memory_order_acquire)) {
+                timers.RunExpired();
+                timers.WaitForNextDeadline();
+            }
+        }
+
+    public:
+        Relay(ryuldn::LdnMasterProxyClient& master, u32 threads) : _master(master), _streams(threads) {}
+
+        // Each Deliver(thread) carries count datagrams for every listed port of that thread
+        void SetInbound(u32 thread, const std::vector<u16>& ports, u32 count, u32 payload) {
+            std::vector<u8> body(payload, 0xA5);
+            std::vector<u8> frame(ryuldn::RyuLdnProtocol::HeaderSize + sizeof(ryuldn::ProxyDataHeaderFull) + payload);
+            for (u32 i = 0; i < count; i++) {
+                for (u16 port : ports) {
+                    ryuldn::ProxyDataHeaderFull header = {};
+                    header.info.sourceIpV4 = PeerIp;
+                    header.info.sourcePort = PeerPort;
+                    header.info.destIpV4 = LocalIp;
+                    header.info.destPort = port;
+                    header.info.protocol = IPPROTO_UDP;
+                    header.dataLength = payload;
+                    const int size = ryuldn::RyuLdnProtocol::Encode(ryuldn::PacketId::ProxyData, header, body.data(), static_cast<int>(payload), frame.data());
+                    _streams[thread].insert(_streams[thread].end(), frame.data(), frame.data() + size);
+                }
+            }
+        }
+
+        void Deliver(u32 thread) {
+            std::scoped_lock lk(_readMutex);
+            _master.GetProtocol()->Read(_streams[thread].data(), 0, static_cast<int>(_streams[thread].size()));
+        }
+
+        void Start() { _thread = std::thread([this] { Run(); }); }
+
+        void Stop() {
+            _stop.store(true, std::memory_order_release);
+            _master.GetTimers().Wake();
+            _thread.join();
+        }
+    };
+
+    // One game thread issuing commands on the shared session
+    class GameThread {
+    private:
+        BsdMitmService& _service;
+        ThreadStats& _stats;
+        std::vector<u8> _payload;
+        std::vector<u8> _receive;
+
+        template<typename F>
+        void Call(Op op, u32 command_id, s32 fd, F&& handler) {
+            const u64 allocs = bench::GetThreadAllocations();
+            const os::Tick start = os::GetSystemTick();
+
+            const ams::Result rc = handler();
+            if (sm::mitm::ResultShouldForwardToSession::Includes(rc)) {
+                bench::mock_bsd::ForwardSession(command_id, fd);
+            }
+
+            const s64 ns = (os::GetSystemTick() - start).GetInt64Value();
+            _stats.latency[op].push_back(static_cast<u32>(std::min<s64>(ns, UINT32_MAX)));
+            _stats.allocations[op] += bench::GetThreadAllocations() - allocs;
+        }
+
+        void CheckRet(s32 ret, u32 err) {
+            if (ret < 0 && err != EAGAIN && err != EWOULDBLOCK) {
+                _stats.failures++;
+            }
+        }
+
+        static sockaddr_in MakeAddr(u32 ip, u16 port) {
+            sockaddr_in addr = {};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(ip);
+            addr.sin_port = htons(port);
+            return addr;
+        }
+
+    public:
+        GameThread(BsdMitmService& service, ThreadStats& stats, const Options& options)
+            : _service(service), _stats(stats), _payload(options.payload, 0x5A), _receive(2048) {}
+
+        // Setup calls are not measured
+        s32 OpenReal() {
+            s32 fd = -1;
+            _service.Socket(sf::Out<s32>(&fd), AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            return fd;
+        }
+
+        s32 OpenVirtual(u16 port) {
+            const s32 fd = OpenReal();
+            s32 ret = 0;
+            u32 err = 0;
+            const sockaddr_in addr = MakeAddr(LocalIp, port);
+            _service.Bind(sf::Out<s32>(&ret), sf::Out<u32>(&err), fd, sf::InAutoSelectBuffer(&addr, sizeof(addr)));
+            _service.Fcntl(sf::Out<s32>(&ret), sf::Out<u32>(&err), fd, BsdFcntlSetFl, BsdNonBlock);
+            return fd;
+        }
+
+        void CloseFd(s32 fd) {
+            s32 ret = 0;
+            u32 err = 0;
+            if (sm::mitm::ResultShouldForwardToSession::Includes(_service.Close(sf::Out<s32>(&ret), sf::Out<u32>(&err), fd))) {
+                bench::mock_bsd::ForwardSession(CmdClose, fd);
+            }
+        }
+
+        // Measured commands
+        void Select(const std::vector<s32>& fds) {
+            fd_set read_set;
+            FD_ZERO(&read_set);
+            s32 nfds = 0;
+            for (s32 fd : fds) {
+                FD_SET(fd, &read_set);
+                nfds = std::max(nfds, fd + 1);
+            }
+            const timeval timeout = { 0, 0 };
+            s32 ret = 0;
+            u32 err = 0;
+            Call(Op_Select, CmdSelect, -1, [&] {
+                return _service.Select(sf::Out<s32>(&ret), sf::Out<u32>(&err), nfds,
+                                       sf::InAutoSelectBuffer(&read_set, sizeof(read_set)),
+                                       sf::InAutoSelectBuffer(), sf::InAutoSelectBuffer(),
+                                       sf::InAutoSelectBuffer(&timeout, sizeof(timeout)));
+            });
+            CheckRet(ret, err);
+        }
+
+        void Poll(const std::vector<s32>& fds) {
+            pollfd pfds[16];
+            const u32 count = static_cast<u32>(std::min<size_t>(fds.size(), 16));
+            for (u32 i = 0; i < count; i++) {
+                pfds[i] = { fds[i], POLLIN, 0 };
+            }
+            s32 ret = 0;
+            u32 err = 0;
+            Call(Op_Poll, CmdPoll, -1, [&] {
+                return _service.Poll(sf::Out<s32>(&ret), sf::Out<u32>(&err), sf::InAutoSelectBuffer(pfds, count * sizeof(pollfd)), count, 0);
+            });
+            CheckRet(ret, err);
+        }
+
+        void RecvFrom(s32 fd) {
+            sockaddr_in from = {};
+            s32 ret = 0;
+            u32 err = 0;
+            u32 addrlen = 0;
+            Call(Op_RecvFrom, CmdRecvFrom, fd, [&] {
+                return _service.RecvFrom(sf::Out<s32>(&ret), sf::Out<u32>(&err), sf::Out<u32>(&addrlen), fd,
+                                         sf::OutAutoSelectBuffer(_receive.data(), _receive.size()), 0,
+                                         sf::OutAutoSelectBuffer(&from, sizeof(from)));
+            });
+            CheckRet(ret, err);
+            if (ret > 0) {
+                _stats.received++;
+            }
+        }
+
+        void SendTo(s32 fd, u32 ip, u16 port) {
+            const sockaddr_in to = MakeAddr(ip, port);
+            s32 ret = 0;
+            u32 err = 0;
+            Call(Op_SendTo, CmdSendTo, fd, [&] {
+                return _service.SendTo(sf::Out<s32>(&ret), sf::Out<u32>(&err), fd,
+                                       sf::InAutoSelectBuffer(_payload.data(), _payload.size()), 0,
+                                       sf::InAutoSelectBuffer(&to, sizeof(to)));
+            });
+            CheckRet(ret, err);
+        }
+
+        void Recv(s32 fd) {
+            s32 ret = 0;
+            u32 err = 0;
+            Call(Op_Recv, CmdRecv, fd, [&] {
+                return _service.Recv(sf::Out<s32>(&ret), sf::Out<u32>(&err), fd, sf::OutAutoSelectBuffer(_receive.data(), _receive.size()), 0);
+            });
+        }
+
+        void Send(s32 fd) {
+            s32 ret = 0;
+            u32 err = 0;
+            Call(Op_Send, CmdSend, fd, [&] {
+                return _service.Send(sf::Out<s32>(&ret), sf::Out<u32>(&err), fd, sf::InAutoSelectBuffer(_payload.data(), _payload.size()), 0);
+            });
+        }
+
+        void GetSockOpt(s32 fd) {
+            s32 value = 0;
+            s32 ret = 0;
+            u32 err = 0;
+            u32 optlen = 0;
+            Call(Op_GetSockOpt, CmdGetSockOpt, fd, [&] {
+                return _service.GetSockOpt(sf::Out<s32>(&ret), sf::Out<u32>(&err), sf::Out<u32>(&optlen), fd, SOL_SOCKET, SO_ERROR,
+                                           sf::OutAutoSelectBuffer(&value, sizeof(value)));
+            });
+            CheckRet(ret, err);
+        }
+
+        // Socket + Close of a short-lived real socket (DNS, HTTP): takes the table lock exclusively
+        void Churn() {
+            s32 fd = -1;
+            Call(Op_Socket, CmdSocket, -1, [&] { return _service.Socket(sf::Out<s32>(&fd), AF_INET, SOCK_STREAM, IPPROTO_TCP); });
+            s32 ret = 0;
+            u32 err = 0;
+            Call(Op_Close, CmdClose, fd, [&] { return _service.Close(sf::Out<s32>(&ret), sf::Out<u32>(&err), fd); });
+        }
+    };
+
+    struct WorkloadResult {
+        std::string name;
+        double ops_per_sec;
+        u32 p50, p90, p99, p999, max;
+        double allocs_per_op;
+    };
+
+    u32 Percentile(const std::vector<u32>& sorted, double pct) {
+        if (sorted.empty()) {
+            return 0;
+        }
+        const size_t index = std::min(sorted.size() - 1, static_cast<size_t>(pct / 100.0 * sorted.size()));
+        return sorted[index];
+    }
+
+    using ThreadBody = void (*)(GameThread& game, Relay& relay, u32 index, const Options& options);
+
+    // Game frame loop: one datagram to ourselves, mostly readiness polling, then drain one
+    void SelectHeavy(GameThread& game, Relay& relay, u32 index, const Options& options) {
+        AMS_UNUSED(relay);
+        const u16 base = FirstPort + index * PortsPerThread;
+        std::vector<s32> virtual_fds, all_fds;
+        for (u16 i = 0; i < 4; i++) {
+            virtual_fds.push_back(game.OpenVirtual(base + i));
+        }
+        all_fds = virtual_fds;
+        for (int i = 0; i < 4; i++) {
+            all_fds.push_back(game.OpenReal());
+        }
+
+        for (u32 op = 0; op < options.ops; ) {
+            const u32 slot = op % 8;
+            const u32 round = op / 8;
+            if (slot == 0) {
+                game.SendTo(virtual_fds[round % 4], LocalIp, base + (round + 1) % 4);
+            } else if (slot == 6) {
+                game.RecvFrom(virtual_fds[(round + 1) % 4]);
+            } else {
+                game.Select(all_fds);
+            }
+            op++;
+        }
+
+        for (s32 fd : all_fds) {
+            game.CloseFd(fd);
+        }
+    }
+
+    // Receive loop fed by the remote player, with an occasional reply through the relay
+    void RecvFromHeavy(GameThread& game, Relay& relay, u32 index, const Options& options) {
+        const u16 base = FirstPort + index * PortsPerThread;
+        const s32 fds[2] = { game.OpenVirtual(base), game.OpenVirtual(base + 1) };
+
+        // Each round of 8: one relay read (3 datagrams per socket), 6 receives that find data,
+        // one that finds the queue empty, and a reply
+        for (u32 op = 0; op < options.ops; op++) {
+            const u32 slot = op % 8;
+            if (slot == 0) {
+                relay.Deliver(index);
+            }
+            if (slot == 7) {
+                game.SendTo(fds[0], PeerIp, PeerPort);
+            } else {
+                game.RecvFrom(fds[slot % 2]);
+            }
+        }
+
+        game.CloseFd(fds[0]);
+        game.CloseFd(fds[1]);
+    }
+
+    // Virtual LDN traffic next to the game's real sockets (matchmaking, telemetry) and socket churn
+    void Mixed(GameThread& game, Relay& relay, u32 index, const Options& options) {
+        const u16 base = FirstPort + index * PortsPerThread;
+        const s32 v0 = game.OpenVirtual(base), v1 = game.OpenVirtual(base + 1);
+        std::vector<s32> real_fds;
+        for (int i = 0; i < 4; i++) {
+            real_fds.push_back(game.OpenReal());
+        }
+        std::vector<s32> all_fds = real_fds;
+        all_fds.push_back(v0);
+        all_fds.push_back(v1);
+
+        for (u32 op = 0; op < options.ops; ) {
+            const u32 round = op / 16;
+            const s32 real = real_fds[round % real_fds.size()];
+            switch (op % 16) {
+                case 0:          relay.Deliver(index); game.Poll(all_fds); break;
+                case 8:          game.Poll(all_fds); break;
+                case 1: case 9:  game.Recv(real); break;
+                case 2: case 10: game.Send(real); break;
+                case 3:          game.SendTo(v0, LocalIp, base + 1); break;
+                case 4: case 12: game.RecvFrom(v1); break;
+                case 5:          game.GetSockOpt(v0); break;
+                case 6: case 13: game.Select(all_fds); break;
+                case 7:          game.SendTo(v0, PeerIp, PeerPort); break;
+                case 11:         game.SendTo(v1, LocalIp, base); break;
+                case 14:         game.RecvFrom(v0); break;
+                case 15:         game.Churn(); op++; break;   // Socket + Close
+            }
+            op++;
+        }
+
+        for (s32 fd : all_fds) {
+            game.CloseFd(fd);
+        }
+    }
+
+    WorkloadResult RunWorkload(const char* name, ThreadBody body, u32 inbound, const Options& options) {
+        ryuldn::LdnMasterProxyClient master("127.0.0.1", 30456, false);
+        ryuldn::ProxyConfig config = { LocalIp, SubnetMask };
+        ryuldn::proxy::LdnProxy proxy(config, &master, master.GetProtocol());
+        BsdMitmService::RegisterProxy(&proxy);
+
+        // Remote traffic goes to the first two ports of each thread
+        Relay relay(master, options.threads);
+        for (u32 t = 0; t < options.threads && inbound != 0; t++) {
+            const u16 base = FirstPort + t * PortsPerThread;
+            relay.SetInbound(t, { base, static_cast<u16>(base + 1) }, inbound, options.payload);
+        }
+
+        std::vector<ThreadStats> stats(options.threads);
+        const u64 dispatches = bench::mock_bsd::GetDispatchCount();
+        const u64 forwards = bench::mock_bsd::GetForwardCount();
+        const u64 relay_packets = bench::GetRelayPackets();
+        s64 elapsed_ns = 0;
+        {
+            BsdMitmService service(std::make_shared<::Service>(), sm::MitmProcessInfo{ { 0x80 }, { 0x0100000000010000 } });
+            for (auto& s : stats) {
+                s.Reserve(options.ops);
+            }
+
+            relay.Start();
+            std::atomic<u32> ready{0};
+            std::atomic<bool> go{false};
+            std::vector<std::thread> threads;
+            for (u32 t = 0; t < options.threads; t++) {
+                threads.emplace_back([&, t] {
+                    GameThread game(service, stats[t], options);
+                    ready++;
+                    while (!go.load(std::memory_order_acquire)) {
+                        std::this_thread::yield();
+                    }
+                    body(game, relay, t, options);
+                });
+            }
+            while (ready.load() != options.threads) {
+                std::this_thread::yield();
+            }
+            const os::Tick start = os::GetSystemTick();
+            go.store(true, std::memory_order_release);
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            elapsed_ns = (os::GetSystemTick() - start).GetInt64Value();
+            relay.Stop();
+        }
+        BsdMitmService::UnregisterProxy();
+
+        std::printf("workload %s: %u threads x %u ops, %.3f s\n", name, options.threads, options.ops, elapsed_ns / 1e9);
+        std::printf("  %-11s %10s %8s %8s %8s %9s\n", "command", "calls", "p50 ns", "p99 ns", "max ns", "allocs/op");
+
+        std::vector<u32> all;
+        u64 total_allocs = 0, failures = 0, received = 0;
+        for (u32 op = 0; op < Op_Count; op++) {
+            std::vector<u32> samples;
+            u64 allocs = 0;
+            for (auto& s : stats) {
+                samples.insert(samples.end(), s.latency[op].begin(), s.latency[op].end());
+                allocs += s.allocations[op];
+            }
+            if (samples.empty()) {
+                continue;
+            }
+            std::sort(samples.begin(), samples.end());
+            std::printf("  %-11s %10zu %8u %8u %8u %9.3f\n", OpNames[op], samples.size(),
+                        Percentile(samples, 50), Percentile(samples, 99), samples.back(),
+                        static_cast<double>(allocs) / samples.size());
+            all.insert(all.end(), samples.begin(), samples.end());
+            total_allocs += allocs;
+        }
+        for (auto& s : stats) {
+            failures += s.failures;
+            received += s.received;
+        }
+        std::sort(all.begin(), all.end());
+
+        WorkloadResult result;
+        result.name = name;
+        result.ops_per_sec = all.size() / (elapsed_ns / 1e9);
+        result.p50 = Percentile(all, 50);
+        result.p90 = Percentile(all, 90);
+        result.p99 = Percentile(all, 99);
+        result.p999 = Percentile(all, 99.9);
+        result.max = all.empty() ? 0 : all.back();
+        result.allocs_per_op = all.empty() ? 0 : static_cast<double>(total_allocs) / all.size();
+
+        std::printf("  total: %.0f ops/s, p50 %u ns, p90 %u ns, p99 %u ns, p99.9 %u ns, max %u ns, %.3f allocs/op\n",
+                    result.ops_per_sec, result.p50, result.p90, result.p99, result.p999, result.max, result.allocs_per_op);
+        std::printf("  bsd: %" PRIu64 " dispatched by the handlers, %" PRIu64 " forwarded whole; relay: %" PRIu64 " packets out; "
+                    "%" PRIu64 " datagrams received; failed calls: %" PRIu64 "\n",
+                    bench::mock_bsd::GetDispatchCount() - dispatches, bench::mock_bsd::GetForwardCount() - forwards,
+                    bench::GetRelayPackets() - relay_packets, received, failures);
+        std::printf("RESULT workload=%s ops_per_sec=%.0f p50_ns=%u p90_ns=%u p99_ns=%u allocs_per_op=%.4f\n\n",
+                    name, result.ops_per_sec, result.p50, result.p90, result.p99, result.allocs_per_op);
+        return result;
+    }
+
+    // Fails the run when a workload lost more than the tolerated throughput or allocates more per command
+    bool CheckBaseline(const std::vector<WorkloadResult>& results, const Options& options) {
+        std::ifstream file(options.baseline);
+        if (!file) {
+            std::fprintf(stderr, "cannot read baseline %s\n", options.baseline.c_str());
+            return false;
+        }
+
+        std::map<std::string, std::map<std::string, double>> baseline;
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.rfind("RESULT ", 0) != 0) {
+                continue;
+            }
+            std::istringstream fields(line.substr(7));
+            std::string field, workload;
+            std::map<std::string, double> values;
+            while (fields >> field) {
+                const size_t eq = field.find('=');
+                if (eq == std::string::npos) {
+                    continue;
+                }
+                if (field.compare(0, eq, "workload") == 0) {
+                    workload = field.substr(eq + 1);
+                } else {
+                    values[field.substr(0, eq)] = std::atof(field.c_str() + eq + 1);
+                }
+            }
+            baseline[workload] = values;
+        }
+
+        bool ok = true;
+        for (const auto& result : results) {
+            auto it = baseline.find(result.name);
+            if (it == baseline.end()) {
+                std::printf("GATE %s: no baseline, skipped\n", result.name.c_str());
+                continue;
+            }
+            const double base_ops = it->second["ops_per_sec"];
+            const double base_allocs = it->second["allocs_per_op"];
+            const double min_ops = base_ops * (1.0 - options.tolerance / 100.0);
+            const bool ops_ok = result.ops_per_sec >= min_ops;
+            const bool allocs_ok = result.allocs_per_op <= base_allocs + 0.0005;
+            std::printf("GATE %s: ops/s %.0f (baseline %.0f, min %.0f) %s, allocs/op %.4f (baseline %.4f) %s\n",
+                        result.name.c_str(), result.ops_per_sec, base_ops, min_ops, ops_ok ? "ok" : "FAIL",
+                        result.allocs_per_op, base_allocs, allocs_ok ? "ok" : "FAIL");
+            ok = ok && ops_ok && allocs_ok;
+        }
+        return ok;
+    }
+
+    void PrintUsage(const char* argv0) {
+        std::printf("usage: %s [options]\n"
+                    "  --workload NAME   select, recvfrom, mixed or all (default all)\n"
+                    "  --threads N       game threads sharing the session (default 4)\n"
+                    "  --ops N           commands per thread (default 200000)\n"
+                    "  --payload N       datagram size in bytes (default 128)\n"
+                    "  --forward-ns N    cost of a request that reaches bsd (default 0)\n"
+                    "  --baseline FILE   compare with the RESULT lines of an earlier run, exit 1 on regression\n"
+                    "  --tolerance PCT   ops/s a gated run may lose (default 10)\n"
+                    "  --log-level N     sysmodule log level, to stderr (default 0)\n", argv0);
+    }
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--workload" && has_value) {
+            options.workload = argv[++i];
+        } else if (arg == "--threads" && has_value) {
+            options.threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--ops" && has_value) {
+            options.ops = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--payload" && has_value) {
+            options.payload = std::clamp(std::atoi(argv[++i]), 1, 1400);
+        } else if (arg == "--forward-ns" && has_value) {
+            options.forward_ns = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--baseline" && has_value) {
+            options.baseline = argv[++i];
+        } else if (arg == "--tolerance" && has_value) {
+            options.tolerance = std::atof(argv[++i]);
+        } else if (arg == "--log-level" && has_value) {
+            options.log_level = std::atoi(argv[++i]);
+        } else {
+            PrintUsage(argv[0]);
+            return arg == "--help" ? 0 : 2;
+        }
+    }
+    if (options.threads * PortsPerThread + FirstPort > 65535) {
+        std::fprintf(stderr, "too many threads\n");
+        return 2;
+    }
+
+    ams::log::gLogLevel = options.log_level;
+    bench::mock_bsd::SetForwardCost(options.forward_ns);
+    if (R_FAILED(ryuldn::InitializeBufferPool())) {
+        std::fprintf(stderr, "buffer pool initialization failed\n");
+        return 1;
+    }
+
+    struct Workload {
+        const char* name;
+        ThreadBody body;
+        u32 inbound;   // Remote datagrams per port in each relay read
+    };
+    constexpr Workload Workloads[] = {
+        { "select",   SelectHeavy,   0 },
+        { "recvfrom", RecvFromHeavy, 3 },
+        { "mixed",    Mixed,         1 },
+    };
+
+    std::vector<WorkloadResult> results;
+    for (const auto& workload : Workloads) {
+        if (options.workload == "all" || options.workload == workload.name) {
+            results.push_back(RunWorkload(workload.name, workload.body, workload.inbound, options));
+        }
+    }
+    if (results.empty()) {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    ryuldn::FinalizeBufferPool();
+
+    if (!options.baseline.empty() && !CheckBaseline(results, options)) {
+        return 1;
+    }
+    return 0;
+}
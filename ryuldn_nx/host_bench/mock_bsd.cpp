@@ -0,0 +1,152 @@
+// Mock bsd:u service: the far side of m_forward_service
+// Hands out fds like bsd (lowest free first); real sockets never have data to read and can always send
+#include "bench.hpp"
+#include <stratosphere.hpp>
+#include <sys/select.h>
+#include <poll.h>
+#include <cstring>
+#include <errno.h>
+
+namespace bench::mock_bsd {
+
+    namespace {
+
+        constexpr s32 FirstFd = 3;   // 0-2 are taken in a real process too
+        constexpr s32 MaxFds = FD_SETSIZE;
+
+        std::mutex g_fdMutex;
+        bool g_fdUsed[MaxFds];
+
+        std::atomic<u64> g_forwardCostNs{0};
+        std::atomic<u64> g_dispatches{0};
+        std::atomic<u64> g_forwards{0};
+
+        const Result ResultInvalidArgument = MAKERESULT(Module_Libnx, 3);
+
+        void SpendForwardCost() {
+            const u64 cost = g_forwardCostNs.load(std::memory_order_relaxed);
+            if (cost == 0) {
+                return;
+            }
+            const s64 end = ams::os::GetSystemTick().GetInt64Value() + static_cast<s64>(cost);
+            while (ams::os::GetSystemTick().GetInt64Value() < end) {
+                /* Spin, an IPC round trip does not yield the calling core either */
+            }
+        }
+
+        s32 AllocateFd() {
+            std::scoped_lock lk(g_fdMutex);
+            for (s32 fd = FirstFd; fd < MaxFds; fd++) {
+                if (!g_fdUsed[fd]) {
+                    g_fdUsed[fd] = true;
+                    return fd;
+                }
+            }
+            return -1;
+        }
+
+        bool FreeFd(s32 fd) {
+            std::scoped_lock lk(g_fdMutex);
+            if (fd < FirstFd || fd >= MaxFds || !g_fdUsed[fd]) {
+                return false;
+            }
+            g_fdUsed[fd] = false;
+            return true;
+        }
+
+        s32 CountSet(const fd_set* set) {
+            s32 count = 0;
+            for (s32 fd = 0; fd < MaxFds; fd++) {
+                if (FD_ISSET(fd, set)) {
+                    count++;
+                }
+            }
+            return count;
+        }
+
+        struct RetErrno {
+            s32 ret;
+            u32 errno_val;
+        };
+
+    }
+
+    void SetForwardCost(u64 ns) {
+        g_forwardCostNs.store(ns, std::memory_order_relaxed);
+    }
+
+    void ForwardSession(u32 command_id, s32 fd) {
+        g_forwards.fetch_add(1, std::memory_order_relaxed);
+        SpendForwardCost();
+
+        // Closing a real socket is the only forwarded request that changes the mock's state
+        if (command_id == 26) {
+            FreeFd(fd);
+        }
+    }
+
+    u64 GetDispatchCount() { return g_dispatches.load(std::memory_order_relaxed); }
+    u64 GetForwardCount() { return g_forwards.load(std::memory_order_relaxed); }
+
+}
+
+Result serviceDispatchImpl(Service* s, u32 request_id, const void* in_data, u32 in_data_size,
+                           void* out_data, u32 out_data_size, SfDispatchParams disp) {
+    using namespace bench::mock_bsd;
+    AMS_UNUSED(s);
+    g_dispatches.fetch_add(1, std::memory_order_relaxed);
+    SpendForwardCost();
+
+    switch (request_id) {
+        case 2: {   // Socket
+            if (out_data_size != sizeof(s32)) {
+                return ResultInvalidArgument;
+            }
+            const s32 fd = AllocateFd();
+            std::memcpy(out_data, &fd, sizeof(fd));
+            return 0;
+        }
+        case 5: {   // Select, only the real fds the handler left in the sets
+            if (out_data_size != sizeof(RetErrno)) {
+                return ResultInvalidArgument;
+            }
+            auto* read = static_cast<fd_set*>(const_cast<void*>(disp.buffers[0].ptr));
+            auto* write = static_cast<fd_set*>(const_cast<void*>(disp.buffers[1].ptr));
+            auto* except = static_cast<fd_set*>(const_cast<void*>(disp.buffers[2].ptr));
+            FD_ZERO(read);
+            FD_ZERO(except);
+            const RetErrno out = { CountSet(write), 0 };
+            std::memcpy(out_data, &out, sizeof(out));
+            return 0;
+        }
+        case 6: {   // Poll
+            if (out_data_size != sizeof(RetErrno)) {
+                return ResultInvalidArgument;
+            }
+            auto* fds = static_cast<pollfd*>(const_cast<void*>(disp.buffers[0].ptr));
+            const size_t count = disp.buffers[0].size / sizeof(pollfd);
+            s32 ready = 0;
+            for (size_t i = 0; i < count; i++) {
+                fds[i].revents = fds[i].events & (POLLOUT | POLLWRNORM);
+                if (fds[i].revents != 0) {
+                    ready++;
+                }
+            }
+            const RetErrno out = { ready, 0 };
+            std::memcpy(out_data, &out, sizeof(out));
+            return 0;
+        }
+        case 26: {  // Close
+            if (in_data_size != sizeof(s32) || out_data_size != sizeof(RetErrno)) {
+                return ResultInvalidArgument;
+            }
+            s32 fd;
+            std::memcpy(&fd, in_data, sizeof(fd));
+            const RetErrno out = FreeFd(fd) ? RetErrno{ 0, 0 } : RetErrno{ -1, EBADF };
+            std::memcpy(out_data, &out, sizeof(out));
+            return 0;
+        }
+        default:
+            return ResultInvalidArgument;
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+// Only the types upnp_client.hpp keeps as members; the UPnP client itself is not built on the host
+
+struct UPNPDev;
+
+struct UPNPUrls {
+    char* controlURL;
+    char* ipcondescURL;
+    char* controlURL_6FC;
+    char* rootdescURL;
+};
+
+struct IGDdatas {
+    char urlbase[128];
+};
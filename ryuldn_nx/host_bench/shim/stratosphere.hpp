@@ -0,0 +1,297 @@
+#pragma once
+// Host stand-in for the subset of libstratosphere the bsd:u mitm path is built on
+// Same names and call shapes as the real library, backed by the C++ standard library
+
+#include <switch.h>
+#include <atomic>
+#include <cinttypes>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <type_traits>
+
+#define AMS_UNUSED(...) static_cast<void>(sizeof(__VA_ARGS__))
+#define AMS_ABORT(...)  do { std::fprintf(stderr, "abort at %s:%d\n", __FILE__, __LINE__); std::abort(); } while (0)
+
+namespace ams {
+
+    class Result {
+    private:
+        u32 m_value;
+    public:
+        constexpr Result() : m_value(0) {}
+        constexpr Result(u32 v) : m_value(v) {}
+
+        constexpr u32 GetValue() const { return m_value; }
+        constexpr bool IsSuccess() const { return m_value == 0; }
+        constexpr bool IsFailure() const { return m_value != 0; }
+    };
+
+    constexpr Result ResultSuccess() { return Result(0); }
+
+    class TimeSpan {
+    private:
+        s64 m_ns;
+    public:
+        constexpr TimeSpan() : m_ns(0) {}
+
+        static constexpr TimeSpan FromNanoSeconds(s64 ns)  { TimeSpan t; t.m_ns = ns; return t; }
+        static constexpr TimeSpan FromMicroSeconds(s64 us) { return FromNanoSeconds(us * 1000); }
+        static constexpr TimeSpan FromMilliSeconds(s64 ms) { return FromNanoSeconds(ms * 1000 * 1000); }
+        static constexpr TimeSpan FromSeconds(s64 s)       { return FromNanoSeconds(s * 1000 * 1000 * 1000); }
+
+        constexpr s64 GetNanoSeconds() const  { return m_ns; }
+        constexpr s64 GetMicroSeconds() const { return m_ns / 1000; }
+        constexpr s64 GetMilliSeconds() const { return m_ns / (1000 * 1000); }
+        constexpr s64 GetSeconds() const      { return m_ns / (1000 * 1000 * 1000); }
+
+        constexpr auto operator<=>(const TimeSpan&) const = default;
+        constexpr TimeSpan operator+(const TimeSpan& rhs) const { return FromNanoSeconds(m_ns + rhs.m_ns); }
+        constexpr TimeSpan operator-(const TimeSpan& rhs) const { return FromNanoSeconds(m_ns - rhs.m_ns); }
+    };
+
+    namespace hos {
+        enum Version : u32 {
+            Version_Min = 0,
+            Version_7_0_0 = 0x07000000,
+        };
+    }
+
+    namespace os {
+
+        // Host ticks are nanoseconds
+        class Tick {
+        private:
+            s64 m_tick;
+        public:
+            constexpr Tick() : m_tick(0) {}
+            constexpr explicit Tick(s64 t) : m_tick(t) {}
+
+            constexpr s64 GetInt64Value() const { return m_tick; }
+
+            constexpr auto operator<=>(const Tick&) const = default;
+            constexpr Tick operator+(const Tick& rhs) const { return Tick(m_tick + rhs.m_tick); }
+            constexpr Tick operator-(const Tick& rhs) const { return Tick(m_tick - rhs.m_tick); }
+        };
+
+        inline Tick GetSystemTick() {
+            return Tick(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+        constexpr TimeSpan ConvertToTimeSpan(Tick tick) { return TimeSpan::FromNanoSeconds(tick.GetInt64Value()); }
+        constexpr Tick ConvertToTick(TimeSpan ts) { return Tick(ts.GetNanoSeconds()); }
+
+        inline void SleepThread(TimeSpan ts) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(ts.GetNanoSeconds()));
+        }
+
+        struct ThreadType {
+            u8 reserved[0x10];
+        };
+
+        class Mutex {
+        private:
+            std::recursive_mutex m_mutex;
+        public:
+            explicit Mutex(bool recursive) { AMS_UNUSED(recursive); }
+
+            void lock() { m_mutex.lock(); }
+            void unlock() { m_mutex.unlock(); }
+            bool try_lock() { return m_mutex.try_lock(); }
+            void Lock() { lock(); }
+            void Unlock() { unlock(); }
+        };
+
+        class SdkMutex {
+        private:
+            std::mutex m_mutex;
+        public:
+            constexpr SdkMutex() = default;
+
+            void lock() { m_mutex.lock(); }
+            void unlock() { m_mutex.unlock(); }
+            bool try_lock() { return m_mutex.try_lock(); }
+        };
+
+        class ReaderWriterLock {
+        private:
+            std::shared_mutex m_lock;
+        public:
+            void lock() { m_lock.lock(); }
+            void unlock() { m_lock.unlock(); }
+            bool try_lock() { return m_lock.try_lock(); }
+            void lock_shared() { m_lock.lock_shared(); }
+            void unlock_shared() { m_lock.unlock_shared(); }
+            bool try_lock_shared() { return m_lock.try_lock_shared(); }
+        };
+
+        enum EventClearMode {
+            EventClearMode_ManualClear = 0,
+            EventClearMode_AutoClear = 1,
+        };
+
+        class SystemEvent {
+        private:
+            std::mutex m_mutex;
+            std::condition_variable m_cv;
+            bool m_signaled;
+            const bool m_auto_clear;
+        public:
+            SystemEvent(EventClearMode mode, bool inter_process) : m_signaled(false), m_auto_clear(mode == EventClearMode_AutoClear) {
+                AMS_UNUSED(inter_process);
+            }
+
+            void Signal() {
+                {
+                    std::scoped_lock lk(m_mutex);
+                    m_signaled = true;
+                }
+                m_cv.notify_all();
+            }
+
+            void Clear() {
+                std::scoped_lock lk(m_mutex);
+                m_signaled = false;
+            }
+
+            void Wait() {
+                std::unique_lock lk(m_mutex);
+                m_cv.wait(lk, [this] { return m_signaled; });
+                if (m_auto_clear) {
+                    m_signaled = false;
+                }
+            }
+
+            bool TryWait() {
+                std::scoped_lock lk(m_mutex);
+                const bool signaled = m_signaled;
+                if (signaled && m_auto_clear) {
+                    m_signaled = false;
+                }
+                return signaled;
+            }
+
+            bool TimedWait(TimeSpan timeout) {
+                std::unique_lock lk(m_mutex);
+                if (!m_cv.wait_for(lk, std::chrono::nanoseconds(timeout.GetNanoSeconds()), [this] { return m_signaled; })) {
+                    return false;
+                }
+                if (m_auto_clear) {
+                    m_signaled = false;
+                }
+                return true;
+            }
+        };
+
+    }
+
+    namespace sf {
+
+        template<typename T>
+        class Out {
+        private:
+            T* m_ptr;
+        public:
+            constexpr Out(T* p) : m_ptr(p) {}
+
+            void SetValue(const T& value) const { *m_ptr = value; }
+            const T& GetValue() const { return *m_ptr; }
+            T* GetPointer() const { return m_ptr; }
+            T& operator*() const { return *m_ptr; }
+            T* operator->() const { return m_ptr; }
+        };
+
+        template<typename T>
+        class OutArray {
+        private:
+            T* m_ptr;
+            size_t m_count;
+        public:
+            constexpr OutArray(T* p, size_t count) : m_ptr(p), m_count(count) {}
+
+            T* GetPointer() const { return m_ptr; }
+            size_t GetSize() const { return m_count; }
+            T& operator[](size_t i) const { return m_ptr[i]; }
+        };
+
+        class InAutoSelectBuffer {
+        private:
+            const void* m_ptr;
+            size_t m_size;
+        public:
+            constexpr InAutoSelectBuffer() : m_ptr(nullptr), m_size(0) {}
+            constexpr InAutoSelectBuffer(const void* p, size_t size) : m_ptr(p), m_size(size) {}
+
+            const u8* GetPointer() const { return static_cast<const u8*>(m_ptr); }
+            size_t GetSize() const { return m_size; }
+        };
+
+        class OutAutoSelectBuffer {
+        private:
+            void* m_ptr;
+            size_t m_size;
+        public:
+            constexpr OutAutoSelectBuffer() : m_ptr(nullptr), m_size(0) {}
+            constexpr OutAutoSelectBuffer(void* p, size_t size) : m_ptr(p), m_size(size) {}
+
+            u8* GetPointer() const { return static_cast<u8*>(m_ptr); }
+            size_t GetSize() const { return m_size; }
+        };
+
+        struct LargeData {};
+        struct PrefersPointerTransferMode {};
+
+    }
+
+    namespace sm {
+
+        struct ProcessId { u64 value; };
+        struct ProgramId { u64 value; };
+
+        struct MitmProcessInfo {
+            ProcessId process_id;
+            ProgramId program_id;
+        };
+
+        namespace mitm {
+            // Tells the framework to replay the untouched request against the real service
+            struct ResultShouldForwardToSession {
+                static constexpr u32 Value = MAKERESULT(21, 1000);
+
+                constexpr operator Result() const { return Result(Value); }
+                static constexpr bool Includes(Result rc) { return rc.GetValue() == Value; }
+            };
+        }
+
+    }
+
+    namespace sf {
+
+        class MitmServiceImplBase {
+        protected:
+            std::shared_ptr<::Service> m_forward_service;
+            sm::MitmProcessInfo m_client_info;
+        public:
+            MitmServiceImplBase(std::shared_ptr<::Service> &&s, const sm::MitmProcessInfo &c) : m_forward_service(std::move(s)), m_client_info(c) {}
+        };
+
+    }
+
+}
+
+#undef R_SUCCEEDED
+#undef R_FAILED
+#define R_SUCCEEDED(res) (static_cast<::ams::Result>(res).IsSuccess())
+#define R_FAILED(res)    (static_cast<::ams::Result>(res).IsFailure())
+
+// The host build has no IPC layer: the interface macros only declare the concept the sources assert on
+#define AMS_SF_METHOD_INFO(...)
+#define AMS_SF_DEFINE_INTERFACE(NAMESPACE, INTERFACE, CMD_MACRO, ID) \
+    namespace NAMESPACE { template<typename T> concept Is##INTERFACE = true; }
+#define AMS_SF_DEFINE_MITM_INTERFACE(NAMESPACE, INTERFACE, CMD_MACRO, ID) \
+    AMS_SF_DEFINE_INTERFACE(NAMESPACE, INTERFACE, CMD_MACRO, ID)
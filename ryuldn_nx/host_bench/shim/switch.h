@@ -0,0 +1,89 @@
+#pragma once
+// Host stand-in for the parts of libnx the bsd:u mitm path uses
+// Only types and the IPC dispatch entry point; the dispatch itself is the mock bsd in mock_bsd.cpp
+
+#include <cstdint>
+#include <cstddef>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t   s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+typedef int64_t  s64;
+
+typedef u32 Result;
+
+#define MAKERESULT(module, description) \
+    ((((module) & 0x1FF)) | ((description) & 0x1FFF) << 9)
+
+enum {
+    Module_Libnx = 345,
+};
+
+enum {
+    LibnxError_OutOfMemory = 2,
+    LibnxError_AlreadyInitialized = 5,
+    LibnxError_IoError = 8,
+};
+
+typedef struct Service {
+    u32 session;
+    u32 own_handle;
+    u32 object_id;
+    u16 pointer_buffer_size;
+} Service;
+
+typedef enum {
+    SfBufferAttr_In                             = 1U << 0,
+    SfBufferAttr_Out                            = 1U << 1,
+    SfBufferAttr_HipcMapAlias                   = 1U << 2,
+    SfBufferAttr_HipcPointer                    = 1U << 3,
+    SfBufferAttr_FixedSize                      = 1U << 4,
+    SfBufferAttr_HipcAutoSelect                 = 1U << 5,
+    SfBufferAttr_HipcMapTransferAllowsNonSecure = 1U << 6,
+    SfBufferAttr_HipcMapTransferAllowsNonDevice = 1U << 7,
+} SfBufferAttr;
+
+typedef struct SfBufferAttrs {
+    u32 attr0, attr1, attr2, attr3, attr4, attr5, attr6, attr7;
+} SfBufferAttrs;
+
+typedef struct SfBuffer {
+    const void* ptr;
+    size_t size;
+} SfBuffer;
+
+typedef struct SfDispatchParams {
+    u32 target_session;
+    u32 context;
+    SfBufferAttrs buffer_attrs;
+    SfBuffer buffers[8];
+    bool in_send_pid;
+    u32 in_num_objects;
+    const Service* in_objects[8];
+    u32 in_num_handles;
+    u32 in_handles[8];
+    u32 out_num_objects;
+    Service* out_objects;
+    u32 out_handle_attrs[8];
+    u32* out_handles;
+} SfDispatchParams;
+
+// Implemented by the mock bsd service the benchmark forwards to
+Result serviceDispatchImpl(Service* s, u32 request_id, const void* in_data, u32 in_data_size,
+                           void* out_data, u32 out_data_size, SfDispatchParams disp);
+
+#define serviceDispatch(_s,_rid,...) \
+    serviceDispatchImpl((_s),(_rid),NULL,0,NULL,0,(SfDispatchParams){ __VA_ARGS__ })
+
+#define serviceDispatchIn(_s,_rid,_in,...) \
+    serviceDispatchImpl((_s),(_rid),&(_in),sizeof(_in),NULL,0,(SfDispatchParams){ __VA_ARGS__ })
+
+#define serviceDispatchOut(_s,_rid,_out,...) \
+    serviceDispatchImpl((_s),(_rid),NULL,0,&(_out),sizeof(_out),(SfDispatchParams){ __VA_ARGS__ })
+
+#define serviceDispatchInOut(_s,_rid,_in,_out,...) \
+    serviceDispatchImpl((_s),(_rid),&(_in),sizeof(_in),&(_out),sizeof(_out),(SfDispatchParams){ __VA_ARGS__ })
@@ -0,0 +1,3 @@
+#pragma once
+// libvapours types come with the stratosphere stand-in on the host
+#include <stratosphere.hpp>
@@ -0,0 +1,128 @@
+// Host definitions for what the benchmarked sources link against outside themselves:
+// logging, the config statics, the mitm heap and the relay side of LdnMasterProxyClient
+#include "bench.hpp"
+#include "../source/debug.hpp"
+#include "../source/ryuldnnx_config.hpp"
+#include "../source/ryuldn/ldn_master_proxy_client.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+namespace ams::log {
+
+    std::atomic<u32> gLogLevel{0};
+
+    void LogFormatImpl(const char *fmt, ...) {
+        std::va_list args;
+        va_start(args, fmt);
+        std::vfprintf(stderr, fmt, args);
+        va_end(args);
+    }
+
+    void LogHexImpl(const void *data, int size) {
+        AMS_UNUSED(data, size);
+    }
+
+    Result Initialize() {
+        return ResultSuccess();
+    }
+
+    void Finalize() {}
+
+    void LogHeapUsage(const char* tag) {
+        AMS_UNUSED(tag);
+    }
+
+}
+
+namespace ams::mitm {
+
+    void* Allocate(size_t size) {
+        return std::malloc(size);
+    }
+
+    void Deallocate(void* p, size_t size) {
+        AMS_UNUSED(size);
+        std::free(p);
+    }
+
+}
+
+namespace ams::mitm::ldn {
+
+    // Defaults from ryuldnnx_config.cpp; the ini loader needs the sd card and is not built here
+    RyuLdnConfig LdnConfig::config = {};
+    std::atomic_bool LdnConfig::enabled = true;
+    std::atomic_bool LdnConfig::logging_enabled = false;
+    std::atomic_uint32_t LdnConfig::logging_level = 1;
+    std::atomic_uint32_t LdnConfig::scan_cache_ms = 1000;
+    std::atomic_uint32_t LdnConfig::socket_pool_size = 4;
+    std::atomic_bool LdnConfig::tcp_optimistic_connect = false;
+    std::atomic_uint32_t LdnConfig::slow_consumer_ms = 500;
+    u64 LdnConfig::bsd_mitm_titles[LdnConfig::MaxBsdMitmTitles] = {};
+    std::atomic_uint32_t LdnConfig::bsd_mitm_title_count = 0;
+    std::function<void(const char*, u32)> LdnConfig::PassphraseUpdateHandler{};
+    std::function<size_t(RyuLdnSocketStats*, size_t)> LdnConfig::SocketStatsHandler{};
+    os::SdkMutex LdnConfig::socket_stats_mutex;
+
+    bool LdnConfig::IsBsdMitmTitle(u64 program_id) {
+        AMS_UNUSED(program_id);
+        return false;
+    }
+
+}
+
+namespace {
+
+    std::atomic<u64> g_relayPackets{0};
+    std::atomic<u64> g_relayBytes{0};
+
+}
+
+namespace bench {
+
+    u64 GetRelayPackets() { return g_relayPackets.load(std::memory_order_relaxed); }
+    u64 GetRelayBytes() { return g_relayBytes.load(std::memory_order_relaxed); }
+
+}
+
+namespace ams::mitm::ldn::ryuldn {
+
+    // Only what LdnProxy touches: the timer queue and the two SendRawPacket overloads.
+    // The worker thread, server socket and P2P proxies are never started.
+    LdnMasterProxyClient::LdnMasterProxyClient(const char* serverAddress, int serverPort, bool useP2pProxy)
+        : _serverAddress(serverAddress),
+          _serverPort(serverPort),
+          _socket(-1),
+          _connected(true),
+          _networkConnected(true),
+          _stop(false),
+          _useP2pProxy(useP2pProxy),
+          _constructionFailed(false),
+          _serverUnreachable(false),
+          _connectionAttempts(0),
+          _workerThread{},
+          _protocol(g_sharedBufferPool),
+          _scanMutex(false),
+          _hostedProxy(nullptr),
+          _connectedProxy(nullptr)
+    {
+    }
+
+    LdnMasterProxyClient::~LdnMasterProxyClient() {
+    }
+
+    int LdnMasterProxyClient::SendRawPacket(const u8* data, int size) {
+        AMS_UNUSED(data);
+        g_relayPackets.fetch_add(1, std::memory_order_relaxed);
+        g_relayBytes.fetch_add(size, std::memory_order_relaxed);
+        return size;
+    }
+
+    int LdnMasterProxyClient::SendRawPacket(const u8* head, int headSize, const u8* body, int bodySize) {
+        AMS_UNUSED(head, body);
+        g_relayPackets.fetch_add(1, std::memory_order_relaxed);
+        g_relayBytes.fetch_add(headSize + bodySize, std::memory_order_relaxed);
+        return headSize + bodySize;
+    }
+
+}
@@ -1,5 +1,6 @@
 #include "bsd_mitm_service.hpp"
 #include "ryuldn/proxy/ldn_proxy_socket.hpp"
+#include "ryuldnnx_config.hpp"
 #include <arpa/inet.h>
 #include <cstring>
 #include <errno.h>
@@ -7,33 +8,124 @@
 #include <poll.h>
 #include <sys/select.h>
 #include <sys/time.h>
-#include <vector>
+#include <iterator>
+#include <shared_mutex>
+#include <optional>
 
 namespace ams::mitm::ldn {
 
+    namespace {
+
+        // One entry of the RecvMMsg/SendMMsg buffer (nn::socket serialized mmsghdr, as decoded by Ryujinx):
+        //   s32 namelen, name[namelen], s32 iovcnt, { u64 len, data[len] } * iovcnt,
+        //   s32 controllen, control[controllen], s32 flags, u32 msg_len
+        // Payload bytes are inline, so virtual sockets read and write them in place.
+        struct SerializedMsgHdr {
+            u8* name;
+            size_t name_len;
+            u8* iov[ryuldn::proxy::ProxyDatagram::MaxSegments];
+            size_t iov_len[ryuldn::proxy::ProxyDatagram::MaxSegments];
+            size_t iov_count;
+            u8* msg_len;
+        };
+
+        template<typename T>
+        bool ReadMsgField(u8*& cursor, const u8* end, T* out) {
+            if (static_cast<size_t>(end - cursor) < sizeof(T)) {
+                return false;
+            }
+            std::memcpy(out, cursor, sizeof(T));
+            cursor += sizeof(T);
+            return true;
+        }
+
+        bool SkipMsgBytes(u8*& cursor, const u8* end, u64 size) {
+            if (static_cast<u64>(end - cursor) < size) {
+                return false;
+            }
+            cursor += size;
+            return true;
+        }
+
+        bool ParseMsgHdr(u8*& cursor, const u8* end, SerializedMsgHdr* out) {
+            s32 name_len = 0;
+            if (!ReadMsgField(cursor, end, &name_len) || name_len < 0) {
+                return false;
+            }
+            out->name = cursor;
+            out->name_len = name_len;
+            if (!SkipMsgBytes(cursor, end, name_len)) {
+                return false;
+            }
+
+            s32 iov_count = 0;
+            if (!ReadMsgField(cursor, end, &iov_count) || iov_count < 0 ||
+                static_cast<size_t>(iov_count) > ryuldn::proxy::ProxyDatagram::MaxSegments) {
+                return false;
+            }
+            out->iov_count = iov_count;
+            for (s32 i = 0; i < iov_count; i++) {
+                u64 iov_len = 0;
+                if (!ReadMsgField(cursor, end, &iov_len)) {
+                    return false;
+                }
+                out->iov[i] = cursor;
+                out->iov_len[i] = iov_len;
+                if (!SkipMsgBytes(cursor, end, iov_len)) {
+                    return false;
+                }
+            }
+
+            s32 control_len = 0;
+            s32 msg_flags = 0;
+            if (!ReadMsgField(cursor, end, &control_len) || control_len < 0 ||
+                !SkipMsgBytes(cursor, end, control_len) ||
+                !ReadMsgField(cursor, end, &msg_flags)) {
+                return false;
+            }
+
+            out->msg_len = cursor;
+            return SkipMsgBytes(cursor, end, sizeof(u32));
+        }
+
+        void SetMsgLen(const SerializedMsgHdr& msg, u32 len) {
+            std::memcpy(msg.msg_len, &len, sizeof(len));
+        }
+
+    }
+
     ryuldn::proxy::LdnProxy* BsdMitmService::s_proxy = nullptr;
+    ryuldn::proxy::LdnProxySocketPool BsdMitmService::s_socket_pool;
+    std::atomic<u32> BsdMitmService::s_scratch_heap_fallbacks{0};
+    BsdMitmService::LdnClientEntry BsdMitmService::s_ldn_clients[MaxLdnClients] = {};
+    constinit os::SdkMutex BsdMitmService::s_ldn_clients_mutex;
 
     BsdMitmService::BsdMitmService(std::shared_ptr<::Service> &&s, const sm::MitmProcessInfo &c)
-        : sf::MitmServiceImplBase(std::forward<std::shared_ptr<::Service>>(s), c),
-          socket_map_mutex(false)
+        : sf::MitmServiceImplBase(std::forward<std::shared_ptr<::Service>>(s), c)
     {
         LOG_INFO_ARGS(COMP_BSD_MITM_SVC, "BsdMitmService created for process: pid=%" PRIu64 ", program_id=0x%016lx",
                 c.process_id, c.program_id.value);
-        std::memset(socket_map, 0, sizeof(socket_map));
-        LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "Socket map initialized (%zu entries)", MaxSockets);
+        LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "Socket map initialized (%zu inline entries, up to %zu fds)", SocketChunkSize, MaxSockets);
     }
 
     BsdMitmService::~BsdMitmService() {
         LOG_INFO(COMP_BSD_MITM_SVC, "BsdMitmService destroyed");
+        LogCommandStats();
 
-        std::scoped_lock lk(socket_map_mutex);
+        std::scoped_lock lk(socket_map_lock);
         int virtual_count = 0, real_count = 0;
-        for (size_t i = 0; i < MaxSockets; i++) {
-            if (socket_map[i].type == SocketType::Virtual) {
-                virtual_count++;
-                LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Virtual socket still open at destruction: fd=%zu", i);
-            } else if (socket_map[i].type == SocketType::Real) {
-                real_count++;
+        for (size_t chunk = 0; chunk < MaxSocketChunks; chunk++) {
+            SocketEntry* entries = chunk == 0 ? socket_map : socket_chunks[chunk].get();
+            if (!entries) {
+                continue;
+            }
+            for (size_t i = 0; i < SocketChunkSize; i++) {
+                if (entries[i].type == SocketType::Virtual) {
+                    virtual_count++;
+                    LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Virtual socket still open at destruction: fd=%zu", chunk * SocketChunkSize + i);
+                } else if (entries[i].real_fd >= 0) {
+                    real_count++;
+                }
             }
         }
         if (virtual_count > 0 || real_count > 0) {
@@ -41,21 +133,116 @@ namespace ams::mitm::ldn {
         }
     }
 
+    BsdMitmService::ScopedCommandStat::ScopedCommandStat(BsdMitmService* service, Command command)
+        : stat(nullptr), start(0)
+    {
+        if (::ams::log::gLogLevel.load(std::memory_order_relaxed) >= 4) {
+            stat = &service->command_stats[static_cast<size_t>(command)];
+            start = os::GetSystemTick();
+        }
+    }
+
+    BsdMitmService::ScopedCommandStat::~ScopedCommandStat() {
+        if (!stat) {
+            return;
+        }
+        const u64 elapsed = (os::GetSystemTick() - start).GetInt64Value();
+        stat->calls.fetch_add(1, std::memory_order_relaxed);
+        stat->ticks.fetch_add(elapsed, std::memory_order_relaxed);
+        u64 max_ticks = stat->max_ticks.load(std::memory_order_relaxed);
+        while (elapsed > max_ticks && !stat->max_ticks.compare_exchange_weak(max_ticks, elapsed, std::memory_order_relaxed)) {}
+    }
+
+    void BsdMitmService::LogCommandStats() {
+        static constexpr const char* CommandNames[] = {
+            "Socket", "Select", "Poll", "Recv", "RecvFrom", "Send", "SendTo", "Accept", "Bind", "Connect", "GetPeerName", "GetSockName", "GetSockOpt", "Listen", "Ioctl", "Fcntl", "SetSockOpt", "Shutdown", "Close", "RecvMMsg", "SendMMsg"
+        };
+        static_assert(std::size(CommandNames) == static_cast<size_t>(Command::Count));
+
+        for (size_t i = 0; i < static_cast<size_t>(Command::Count); i++) {
+            const u64 calls = command_stats[i].calls.load(std::memory_order_relaxed);
+            if (calls == 0) {
+                continue;
+            }
+            const s64 avg_ns = os::ConvertToTimeSpan(os::Tick(command_stats[i].ticks.load(std::memory_order_relaxed) / calls)).GetNanoSeconds();
+            const s64 max_ns = os::ConvertToTimeSpan(os::Tick(command_stats[i].max_ticks.load(std::memory_order_relaxed))).GetNanoSeconds();
+            LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "Command stats %s: calls=%lu, avg=%ld ns, max=%ld ns", CommandNames[i], calls, avg_ns, max_ns);
+        }
+
+        // Process-wide, since the sysmodule started
+        LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "Poll/Select scratch heap fallbacks: %u", GetScratchHeapFallbacks());
+        LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "Virtual socket pool misses: %u", GetSocketPoolMisses());
+    }
+
     bool BsdMitmService::ShouldMitm(const sm::MitmProcessInfo &client_info) {
-        AMS_UNUSED(client_info);
-        // Only MITM if RyuLDN proxy is active
-        bool should = s_proxy != nullptr;
-        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "BsdMitmService::ShouldMitm: program_id=0x%016lx -> %s",
-                 client_info.program_id.value, should ? "YES" : "NO");
+        // Only MITM if RyuLDN proxy is active, and only for the process(es) using LDN.
+        // Everything else (applets, eShop, background services) keeps talking to bsd directly.
+        bool should = s_proxy != nullptr &&
+                      (IsLdnClient(client_info.process_id.value) ||
+                       LdnConfig::IsBsdMitmTitle(client_info.program_id.value));
+        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "BsdMitmService::ShouldMitm: pid=%" PRIu64 ", program_id=0x%016lx -> %s",
+                 client_info.process_id.value, client_info.program_id.value, should ? "YES" : "NO");
         return should;
     }
 
+    bool BsdMitmService::IsLdnClient(u64 process_id) {
+        std::scoped_lock lk(s_ldn_clients_mutex);
+        for (const auto& client : s_ldn_clients) {
+            if (client.refs > 0 && client.process_id == process_id) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void BsdMitmService::RegisterLdnClient(u64 process_id) {
+        std::scoped_lock lk(s_ldn_clients_mutex);
+        LdnClientEntry* free_entry = nullptr;
+        for (auto& client : s_ldn_clients) {
+            if (client.refs > 0 && client.process_id == process_id) {
+                client.refs++;
+                return;
+            }
+            if (client.refs == 0 && free_entry == nullptr) {
+                free_entry = &client;
+            }
+        }
+
+        if (free_entry == nullptr) {
+            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "RegisterLdnClient: no free slot for pid=%" PRIu64, process_id);
+            return;
+        }
+        free_entry->process_id = process_id;
+        free_entry->refs = 1;
+        LOG_INFO_ARGS(COMP_BSD_MITM_SVC, "LDN client registered: pid=%" PRIu64, process_id);
+    }
+
+    void BsdMitmService::UnregisterLdnClient(u64 process_id) {
+        std::scoped_lock lk(s_ldn_clients_mutex);
+        for (auto& client : s_ldn_clients) {
+            if (client.refs > 0 && client.process_id == process_id) {
+                if (--client.refs == 0) {
+                    LOG_INFO_ARGS(COMP_BSD_MITM_SVC, "LDN client unregistered: pid=%" PRIu64, process_id);
+                }
+                return;
+            }
+        }
+    }
+
     void BsdMitmService::RegisterProxy(ryuldn::proxy::LdnProxy* proxy) {
         LOG_INFO_ARGS(COMP_BSD_MITM_SVC, "BsdMitmService: Registering RyuLDN proxy at %p", (void*)proxy);
         if (!proxy) {
             LOG_WARN(COMP_BSD_MITM_SVC, "Null proxy being registered!");
         }
+        if (proxy) {
+            // Accepted connections are created by the proxy, they come from the same pool
+            proxy->SetSocketPool(&s_socket_pool);
+        }
         s_proxy = proxy;
+        if (proxy) {
+            // Construct the idle sockets now rather than on the game's first socket call
+            s_socket_pool.Prefill(LdnConfig::GetSocketPoolSize());
+        }
         LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "proxy=null", "proxy=active");
     }
 
@@ -66,6 +253,7 @@ namespace ams::mitm::ldn {
     }
 
     BsdMitmService::SocketEntry* BsdMitmService::GetSocketEntry(s32 fd) {
+        // Caller must hold socket_map_lock (shared is enough)
         if (fd < 0 || static_cast<size_t>(fd) >= MaxSockets) {
             if (fd < 0) {
                 LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "GetSocketEntry: Invalid fd=%d (negative)", fd);
@@ -74,7 +262,34 @@ namespace ams::mitm::ldn {
             }
             return nullptr;
         }
-        return &socket_map[fd];
+
+        const size_t index = static_cast<size_t>(fd);
+        if (index < SocketChunkSize) {
+            return &socket_map[index];
+        }
+
+        // fds in a chunk that was never opened are plain real sockets we have no state for
+        SocketEntry* chunk = socket_chunks[index / SocketChunkSize].get();
+        return chunk ? &chunk[index % SocketChunkSize] : nullptr;
+    }
+
+    BsdMitmService::SocketEntry* BsdMitmService::CreateSocketEntry(s32 fd) {
+        // Caller must hold socket_map_lock for writing
+        SocketEntry* entry = GetSocketEntry(fd);
+        if (entry || fd < 0 || static_cast<size_t>(fd) >= MaxSockets) {
+            return entry;
+        }
+
+        const size_t chunk_index = static_cast<size_t>(fd) / SocketChunkSize;
+        SocketEntry* chunk = new (std::nothrow) SocketEntry[SocketChunkSize];
+        if (chunk == nullptr) {
+            LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "Failed to allocate socket map chunk for fd=%d - out of memory", fd);
+            return nullptr;
+        }
+        socket_chunks[chunk_index].reset(chunk);
+        LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "Socket map grown: fds %zu-%zu", chunk_index * SocketChunkSize, (chunk_index + 1) * SocketChunkSize - 1);
+
+        return &chunk[static_cast<size_t>(fd) % SocketChunkSize];
     }
 
     bool BsdMitmService::IsRyuLdnVirtualIP(u32 ip) {
@@ -100,31 +315,107 @@ namespace ams::mitm::ldn {
         return false;
     }
 
-    ryuldn::proxy::LdnProxySocket* BsdMitmService::GetVirtualSocket(s32 fd) {
+    bool BsdMitmService::IsVirtualSocket(s32 fd) {
+        // Most processes never create a virtual socket: skip the table entirely
+        if (virtual_socket_count.load(std::memory_order_acquire) == 0) {
+            return false;
+        }
+
+        std::shared_lock lk(socket_map_lock);
         SocketEntry* entry = GetSocketEntry(fd);
+        return entry && entry->type == SocketType::Virtual;
+    }
+
+    BsdMitmService::VirtualSocketRef BsdMitmService::MarkVirtual(s32 fd, u32* out_generation) {
+        std::scoped_lock lk(socket_map_lock);
+        SocketEntry* entry = CreateSocketEntry(fd);
         if (!entry) {
             return nullptr;
         }
+        if (entry->type != SocketType::Virtual) {
+            entry->type = SocketType::Virtual;
+            virtual_socket_count++;
+        }
+        if (out_generation) {
+            *out_generation = entry->generation;
+        }
+        return GetOrCreateVirtualSocket(entry);
+    }
+
+    bool BsdMitmService::IsSameSocket(s32 fd, u32 generation) {
+        std::shared_lock lk(socket_map_lock);
+        SocketEntry* entry = GetSocketEntry(fd);
+        return entry && entry->generation == generation;
+    }
+
+    BsdMitmService::VirtualSocketRef BsdMitmService::GetOrCreateVirtualSocket(SocketEntry* entry) {
+        // Caller must hold socket_map_lock for writing
+        if (entry->virtual_socket || !s_proxy) {
+            return entry->virtual_socket;
+        }
 
-        auto* socket = reinterpret_cast<ryuldn::proxy::LdnProxySocket*>(entry->virtual_socket);
-        if (socket) {
-            return socket;
+        // The socket registers itself with the proxy when opened; the last handle returns it to the pool
+        entry->virtual_socket = s_socket_pool.Acquire(static_cast<s32>(entry->address_family),
+                                                      static_cast<s32>(entry->socket_type),
+                                                      static_cast<s32>(entry->protocol_type),
+                                                      s_proxy);
+        if (!entry->virtual_socket) {
+            LOG_ERR(COMP_BSD_MITM_SVC, "Failed to allocate LdnProxySocket - out of memory");
         }
+        return entry->virtual_socket;
+    }
 
-        if (!s_proxy) {
-            return nullptr;
+    BsdMitmService::VirtualSocketRef BsdMitmService::AcquireVirtualSocket(s32 fd, u32* out_generation) {
+        // Fast path: socket already created, only a shared lock is needed
+        {
+            std::shared_lock lk(socket_map_lock);
+            SocketEntry* entry = GetSocketEntry(fd);
+            if (!entry || entry->type != SocketType::Virtual) {
+                return nullptr;
+            }
+            if (entry->virtual_socket) {
+                if (out_generation) {
+                    *out_generation = entry->generation;
+                }
+                return entry->virtual_socket;
+            }
         }
 
-        // Create a new virtual socket for this fd
-        socket = new ryuldn::proxy::LdnProxySocket(static_cast<s32>(entry->address_family),
-                                                   static_cast<s32>(entry->socket_type),
-                                                   static_cast<s32>(entry->protocol_type),
-                                                   s_proxy);
-        s_proxy->RegisterSocket(socket);
-        entry->virtual_socket = socket;
-        return socket;
+        std::scoped_lock lk(socket_map_lock);
+        SocketEntry* entry = GetSocketEntry(fd);
+        if (!entry || entry->type != SocketType::Virtual) {
+            return nullptr;
+        }
+        if (out_generation) {
+            *out_generation = entry->generation;
+        }
+        return GetOrCreateVirtualSocket(entry);
     }
 
+    // Inline storage for the common small sets; heap only past InlineCount elements
+    template<typename T, size_t InlineCount>
+    class ScratchArray {
+    private:
+        T inline_storage[InlineCount];
+        std::unique_ptr<T[]> heap_storage;
+        T* data = inline_storage;
+
+    public:
+        // Returns false if a heap fallback was needed and failed
+        bool Reserve(size_t count) {
+            if (count <= InlineCount) {
+                return true;
+            }
+            heap_storage.reset(new (std::nothrow) T[count]);
+            data = heap_storage.get();
+            return data != nullptr;
+        }
+
+        bool IsHeap() const { return heap_storage != nullptr; }
+        T* Get() { return data; }
+        T& operator[](size_t index) { return data[index]; }
+    };
+
     static void ClearFd(fd_set* set, int fd) {
         if (set) {
             FD_CLR(fd, set);
@@ -142,6 +433,7 @@ namespace ams::mitm::ldn {
     }
 
     Result BsdMitmService::Socket(sf::Out<s32> out_fd, u32 domain, u32 type, u32 protocol) {
+        ScopedCommandStat stat(this, Command::Socket);
         LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "Socket request: domain=%u, type=%u, protocol=%u", domain, type, protocol);
 
         // Forward to real BSD service using IPC
@@ -161,14 +453,22 @@ namespace ams::mitm::ldn {
         }
 
         // Register in our map
-        std::scoped_lock lk(socket_map_mutex);
-        if (real_fd >= 0 && static_cast<size_t>(real_fd) < MaxSockets) {
-            socket_map[real_fd].type = SocketType::Real;
-            socket_map[real_fd].real_fd = real_fd;
-            socket_map[real_fd].virtual_socket = nullptr;
-            socket_map[real_fd].address_family = domain;
-            socket_map[real_fd].socket_type = type;
-            socket_map[real_fd].protocol_type = protocol;
+        VirtualSocketRef stale;
+        std::scoped_lock lk(socket_map_lock);
+        SocketEntry* entry = real_fd >= 0 ? CreateSocketEntry(real_fd) : nullptr;
+        if (entry) {
+            // A new generation makes any handle still tied to the previous owner of this fd number stale
+            stale = std::move(entry->virtual_socket);
+            if (entry->type == SocketType::Virtual) {
+                virtual_socket_count--;
+            }
+            entry->type = SocketType::Real;
+            entry->real_fd = real_fd;
+            entry->virtual_socket = nullptr;
+            entry->address_family = domain;
+            entry->socket_type = type;
+            entry->protocol_type = protocol;
+            entry->generation++;
 
             LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "NET Socket fd=%d domain=%u type=%u proto=%u", real_fd, domain, type, protocol); 
             LOG_INFO_ARGS(COMP_BSD_MITM_SVC, "BSD Socket registered in map: fd=%d", real_fd);
@@ -176,7 +476,7 @@ namespace ams::mitm::ldn {
             if (real_fd < 0) {
                 LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "BSD Socket returned negative fd=%d", real_fd);
             } else {
-                LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "BSD Socket fd=%d exceeds MaxSockets=%zu, cannot register!", real_fd, MaxSockets);
+                LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "BSD Socket fd=%d could not be registered (MaxSockets=%zu)", real_fd, MaxSockets);
             }
         }
 
@@ -185,6 +485,7 @@ namespace ams::mitm::ldn {
     }
 
     Result BsdMitmService::Bind(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, sf::InAutoSelectBuffer addr) {
+        ScopedCommandStat stat(this, Command::Bind);
         LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "Bind request: fd=%d, addr_size=%zu", fd, addr.GetSize());
 
         // Check if binding to a virtual IP
@@ -210,26 +511,21 @@ namespace ams::mitm::ldn {
                     }
 
                     // Mark this socket as virtual
-                    std::scoped_lock lk(socket_map_mutex);
-                    SocketEntry* entry = GetSocketEntry(fd);
-                    if (entry) {
-                        entry->type = SocketType::Virtual;
-                        auto* vsock = GetVirtualSocket(fd);
-                        if (vsock) {
-                            // For INADDR_ANY, create a local endpoint with the proxy IP
-                            sockaddr_in virtualAddr = *sa;
-                            if (sa->sin_addr.s_addr == INADDR_ANY) {
-                                // Bind to proxy IP instead of 0.0.0.0 for virtual reception
-                                virtualAddr.sin_addr.s_addr = htonl(s_proxy->GetLocalIP());
-                                LOG_INFO_ARGS(COMP_BSD_MITM_SVC, "Converting INADDR_ANY bind to proxy IP: 0x%08x:%u",
-                                        s_proxy->GetLocalIP(), ntohs(sa->sin_port));
-                            }
-                            vsock->Bind(&virtualAddr);
+                    auto vsock = MarkVirtual(fd);
+                    if (vsock) {
+                        // For INADDR_ANY, create a local endpoint with the proxy IP
+                        sockaddr_in virtualAddr = *sa;
+                        if (sa->sin_addr.s_addr == INADDR_ANY) {
+                            // Bind to proxy IP instead of 0.0.0.0 for virtual reception
+                            virtualAddr.sin_addr.s_addr = htonl(s_proxy->GetLocalIP());
+                            LOG_INFO_ARGS(COMP_BSD_MITM_SVC, "Converting INADDR_ANY bind to proxy IP: 0x%08x:%u",
+                                    s_proxy->GetLocalIP(), ntohs(sa->sin_port));
                         }
+                        vsock->Bind(&virtualAddr);
                         LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "NET Bind fd=%d port=%u", fd, ntohs(sa->sin_port)); 
                         LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "socket=real", "socket=virtual");
                     } else {
-                        LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Bind: Failed to get socket entry for fd=%d", fd);
+                        LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Bind: Failed to get virtual socket for fd=%d", fd);
                         out_ret.SetValue(-1);
                         out_errno.SetValue(EBADF);
                         return ResultSuccess();
@@ -245,38 +541,13 @@ namespace ams::mitm::ldn {
             LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Bind: addr buffer size %zu < sizeof(sockaddr_in)", addr.GetSize());
         }
 
-        // Normal bind - forward to real BSD service
-        LOG_DBG(COMP_BSD_MITM_SVC, "Forwarding Bind to real BSD service");
-        struct {
-            s32 fd;
-            u32 addrlen;
-        } in_args = { fd, static_cast<u32>(addr.GetSize()) };
-
-        struct {
-            s32 ret;
-            u32 errno_val;
-        } out_args = {};
-
-        Result rc = serviceDispatchInOut(m_forward_service.get(), 13, in_args, out_args,
-            .buffer_attrs = { SfBufferAttr_In | SfBufferAttr_HipcMapAlias },
-            .buffers = { { addr.GetPointer(), addr.GetSize() } },
-        );
-
-        if (R_SUCCEEDED(rc)) {
-            out_ret.SetValue(out_args.ret);
-            out_errno.SetValue(out_args.errno_val);
-            if (out_args.ret == 0) {
-                LOG_INFO_ARGS(COMP_BSD_MITM_SVC, "Bind succeeded: fd=%d, ret=%d", fd, out_args.ret);
-            } else {
-                LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Bind failed: fd=%d, ret=%d, errno=%u", fd, out_args.ret, out_args.errno_val);
-            }
-        } else {
-            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Bind IPC failed: rc=0x%x", rc.GetValue());
-        }
-        return rc;
+        // Not ours: hand the untouched request back to bsd through the mitm framework
+        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Bind: forwarding fd=%d", fd);
+        return sm::mitm::ResultShouldForwardToSession();
     }
 
     Result BsdMitmService::Connect(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, sf::InAutoSelectBuffer addr) {
+        ScopedCommandStat stat(this, Command::Connect);
         LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "Connect request: fd=%d, addr_size=%zu", fd, addr.GetSize());
 
         // Check if connecting to a virtual IP
@@ -295,25 +566,36 @@ namespace ams::mitm::ldn {
                         return ResultSuccess();
                     }
 
-                    // Mark this socket as virtual
-                    std::scoped_lock lk(socket_map_mutex);
-                    SocketEntry* entry = GetSocketEntry(fd);
-                    if (entry) {
-                        entry->type = SocketType::Virtual;
-                        auto* vsock = GetVirtualSocket(fd);
-                        if (vsock) {
-                            vsock->Connect(sa);
+                    // Mark this socket as virtual; Connect may block, so only the handle is held
+                    u32 generation = 0;
+                    auto vsock = MarkVirtual(fd, &generation);
+                    if (vsock) {
+                        errno = 0;
+                        const s32 result = vsock->Connect(sa, LdnConfig::IsTcpOptimisticConnect());
+                        const int connect_errno = errno;
+
+                        // The fd was closed (and maybe reused) while we were waiting for the peer
+                        if (!IsSameSocket(fd, generation)) {
+                            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Connect: fd=%d was closed during connect", fd);
+                            out_ret.SetValue(-1);
+                            out_errno.SetValue(EBADF);
+                            return ResultSuccess();
+                        }
+                        if (result < 0) {
+                            LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "Connect: fd=%d virtual connect failed, errno=%d", fd, connect_errno);
+                            out_ret.SetValue(-1);
+                            out_errno.SetValue(connect_errno);
+                            return ResultSuccess();
                         }
                         LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "NET Connect fd=%d addr=VIRTUAL port=%u", fd, ntohs(sa->sin_port)); 
                         LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "socket=real", "socket=virtual");
                     } else {
-                        LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Connect: Failed to get socket entry for fd=%d", fd);
+                        LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Connect: Failed to get virtual socket for fd=%d", fd);
                         out_ret.SetValue(-1);
                         out_errno.SetValue(EBADF);
                         return ResultSuccess();
                     }
 
-                    // Pretend connect succeeded
                     out_ret.SetValue(0);
                     out_errno.SetValue(0);
                     return ResultSuccess();
@@ -323,40 +605,20 @@ namespace ams::mitm::ldn {
             LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Connect: addr buffer size %zu < sizeof(sockaddr_in)", addr.GetSize());
         }
 
-        // Normal connect - forward to real BSD service
-        LOG_DBG(COMP_BSD_MITM_SVC, "Forwarding Connect to real BSD service");
-        struct {
-            s32 fd;
-            u32 addrlen;
-        } in_args = { fd, static_cast<u32>(addr.GetSize()) };
-
-        struct {
-            s32 ret;
-            u32 errno_val;
-        } out_args = {};
-
-        Result rc = serviceDispatchInOut(m_forward_service.get(), 14, in_args, out_args,
-            .buffer_attrs = { SfBufferAttr_In | SfBufferAttr_HipcMapAlias },
-            .buffers = { { addr.GetPointer(), addr.GetSize() } },
-        );
-
-        if (R_SUCCEEDED(rc)) {
-            out_ret.SetValue(out_args.ret);
-            out_errno.SetValue(out_args.errno_val);
-            if (out_args.ret == 0) {
-                LOG_INFO_ARGS(COMP_BSD_MITM_SVC, "Connect succeeded: fd=%d", fd);
-            } else {
-                LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Connect failed: fd=%d, ret=%d, errno=%u", fd, out_args.ret, out_args.errno_val);
-            }
-        } else {
-            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Connect IPC failed: rc=0x%x", rc.GetValue());
-        }
-        return rc;
+        // Not ours: hand the untouched request back to bsd through the mitm framework
+        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Connect: forwarding fd=%d", fd);
+        return sm::mitm::ResultShouldForwardToSession();
     }
 
     Result BsdMitmService::Select(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 nfds, sf::InAutoSelectBuffer readfds, sf::InAutoSelectBuffer writefds, sf::InAutoSelectBuffer exceptfds, sf::InAutoSelectBuffer timeout) {
+        ScopedCommandStat stat(this, Command::Select);
         LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Select: nfds=%d", nfds);
 
+        // No virtual socket in this process: nothing to merge, let bsd take the original request
+        if (virtual_socket_count.load(std::memory_order_acquire) == 0) {
+            return sm::mitm::ResultShouldForwardToSession();
+        }
+
         fd_set* in_read = readfds.GetSize() ? const_cast<fd_set*>(reinterpret_cast<const fd_set*>(readfds.GetPointer())) : nullptr;
         fd_set* in_write = writefds.GetSize() ? const_cast<fd_set*>(reinterpret_cast<const fd_set*>(writefds.GetPointer())) : nullptr;
         fd_set* in_except = exceptfds.GetSize() ? const_cast<fd_set*>(reinterpret_cast<const fd_set*>(exceptfds.GetPointer())) : nullptr;
@@ -381,13 +643,18 @@ namespace ams::mitm::ldn {
             return ResultSuccess();
         }
 
-        std::vector<bool> ready(static_cast<size_t>(nfds), false);
+        // fd_set buffers cap the scan; ready doubles as the "already counted" set
+        const s32 max_fd = std::min<s32>(nfds, FD_SETSIZE);
+        fd_set ready;
+        FD_ZERO(&ready);
         s32 ready_count = 0;
         bool has_real = false;
+        bool has_virtual = false;
 
         {
-            std::scoped_lock lk(socket_map_mutex);
-            for (s32 fd = 0; fd < nfds; ++fd) {
+            // Readiness checks never block; the shared lock only excludes Socket/Close updates
+            std::shared_lock lk(socket_map_lock);
+            for (s32 fd = 0; fd < max_fd; ++fd) {
                 SocketEntry* entry = GetSocketEntry(fd);
                 if (!entry || entry->type != SocketType::Virtual) {
                     if (TestFd(in_read, fd) || TestFd(in_write, fd) || TestFd(in_except, fd)) {
@@ -396,7 +663,12 @@ namespace ams::mitm::ldn {
                     continue;
                 }
 
-                auto* vsock = GetVirtualSocket(fd);
+                if (!TestFd(in_read, fd) && !TestFd(in_write, fd) && !TestFd(in_except, fd)) {
+                    continue;
+                }
+                has_virtual = true;
+
+                auto* vsock = entry->virtual_socket.get();
                 if (!vsock) {
                     continue;
                 }
@@ -407,15 +679,15 @@ namespace ams::mitm::ldn {
 
                 if (TestFd(in_read, fd) && readable) {
                     SetFd(&out_read, fd);
-                    ready[fd] = true;
+                    SetFd(&ready, fd);
                 }
                 if (TestFd(in_write, fd) && writable) {
                     SetFd(&out_write, fd);
-                    ready[fd] = true;
+                    SetFd(&ready, fd);
                 }
                 if (TestFd(in_except, fd) && has_error) {
                     SetFd(&out_except, fd);
-                    ready[fd] = true;
+                    SetFd(&ready, fd);
                 }
 
                 // Remove virtual fd from forwarding sets
@@ -425,8 +697,12 @@ namespace ams::mitm::ldn {
             }
         }
 
-        for (s32 fd = 0; fd < nfds; ++fd) {
-            if (ready[fd]) {
+        if (!has_virtual) {
+            return sm::mitm::ResultShouldForwardToSession();
+        }
+
+        for (s32 fd = 0; fd < max_fd; ++fd) {
+            if (TestFd(&ready, fd)) {
                 ready_count++;
             }
         }
@@ -485,18 +761,18 @@ namespace ams::mitm::ldn {
                 return ResultSuccess();
             }
 
-            for (s32 fd = 0; fd < nfds; ++fd) {
+            for (s32 fd = 0; fd < max_fd; ++fd) {
                 if (TestFd(&fwd_read, fd)) {
                     SetFd(&out_read, fd);
-                    if (!ready[fd]) { ready_count++; ready[fd] = true; }
+                    if (!TestFd(&ready, fd)) { ready_count++; SetFd(&ready, fd); }
                 }
                 if (TestFd(&fwd_write, fd)) {
                     SetFd(&out_write, fd);
-                    if (!ready[fd]) { ready_count++; ready[fd] = true; }
+                    if (!TestFd(&ready, fd)) { ready_count++; SetFd(&ready, fd); }
                 }
                 if (TestFd(&fwd_except, fd)) {
                     SetFd(&out_except, fd);
-                    if (!ready[fd]) { ready_count++; ready[fd] = true; }
+                    if (!TestFd(&ready, fd)) { ready_count++; SetFd(&ready, fd); }
                 }
             }
         }
@@ -517,8 +793,13 @@ namespace ams::mitm::ldn {
     }
 
     Result BsdMitmService::Poll(sf::Out<s32> out_ret, sf::Out<u32> out_errno, sf::InAutoSelectBuffer fds_buf, u32 nfds, s32 timeout_ms) {
+        ScopedCommandStat stat(this, Command::Poll);
         LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Poll: nfds=%u, timeout=%d", nfds, timeout_ms);
 
+        if (virtual_socket_count.load(std::memory_order_acquire) == 0) {
+            return sm::mitm::ResultShouldForwardToSession();
+        }
+
         if (nfds == 0) {
             out_ret.SetValue(0);
             out_errno.SetValue(0);
@@ -533,16 +814,25 @@ namespace ams::mitm::ldn {
 
         auto* pollfds = const_cast<struct pollfd*>(reinterpret_cast<const struct pollfd*>(fds_buf.GetPointer()));
 
-        std::vector<struct pollfd> real_fds;
-        std::vector<size_t> real_indices;
-        real_fds.reserve(nfds);
-        real_indices.reserve(nfds);
+        ScratchArray<struct pollfd, PollScratchCount> real_fds;
+        ScratchArray<u32, PollScratchCount> real_indices;
+        if (!real_fds.Reserve(nfds) || !real_indices.Reserve(nfds)) {
+            out_ret.SetValue(-1);
+            out_errno.SetValue(ENOMEM);
+            return ResultSuccess();
+        }
+        if (real_fds.IsHeap()) {
+            u32 fallbacks = ++s_scratch_heap_fallbacks;
+            LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "Poll: nfds=%u exceeds inline scratch, heap fallback #%u", nfds, fallbacks);
+        }
+        size_t real_count = 0;
 
         s32 ready_count = 0;
         bool has_real = false;
+        bool has_virtual = false;
 
         {
-            std::scoped_lock lk(socket_map_mutex);
+            std::shared_lock lk(socket_map_lock);
             for (u32 i = 0; i < nfds; ++i) {
                 struct pollfd& pfd = pollfds[i];
                 SocketEntry* entry = GetSocketEntry(pfd.fd);
@@ -550,7 +840,8 @@ namespace ams::mitm::ldn {
                     if (!EnsureProxyAvailable(out_ret, out_errno, "Poll")) {
                         return ResultSuccess();
                     }
-                    auto* vsock = GetVirtualSocket(pfd.fd);
+                    has_virtual = true;
+                    auto* vsock = entry->virtual_socket.get();
                     if (!vsock) {
                         continue;
                     }
@@ -572,13 +863,18 @@ namespace ams::mitm::ldn {
                     }
                 } else {
                     has_real = true;
-                    real_fds.push_back(pfd);
-                    real_indices.push_back(i);
+                    real_fds[real_count] = pfd;
+                    real_indices[real_count] = i;
+                    real_count++;
                 }
             }
         }
 
-        if (has_real && !real_fds.empty()) {
+        if (!has_virtual) {
+            return sm::mitm::ResultShouldForwardToSession();
+        }
+
+        if (has_real && real_count > 0) {
             struct {
                 s32 ret;
                 u32 errno_val;
@@ -587,7 +883,7 @@ namespace ams::mitm::ldn {
             struct {
                 nfds_t nfds;
                 s32 timeout;
-            } in_args = { static_cast<nfds_t>(real_fds.size()), timeout_ms };
+            } in_args = { static_cast<nfds_t>(real_count), timeout_ms };
 
             Result rc = serviceDispatchInOut(m_forward_service.get(), 6, in_args, out_args,
                 .buffer_attrs = {
@@ -595,8 +891,8 @@ namespace ams::mitm::ldn {
                     SfBufferAttr_Out | SfBufferAttr_HipcMapAlias,
                 },
                 .buffers = {
-                    { real_fds.data(), real_fds.size() * sizeof(struct pollfd) },
-                    { real_fds.data(), real_fds.size() * sizeof(struct pollfd) },
+                    { real_fds.Get(), real_count * sizeof(struct pollfd) },
+                    { real_fds.Get(), real_count * sizeof(struct pollfd) },
                 },
             );
 
@@ -612,7 +908,7 @@ namespace ams::mitm::ldn {
             }
 
             // Merge real poll results back
-            for (size_t idx = 0; idx < real_indices.size(); ++idx) {
+            for (size_t idx = 0; idx < real_count; ++idx) {
                 pollfds[real_indices[idx]].revents = real_fds[idx].revents;
                 if (real_fds[idx].revents != 0) {
                     ready_count++;
@@ -626,17 +922,16 @@ namespace ams::mitm::ldn {
     }
 
     Result BsdMitmService::Send(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, sf::InAutoSelectBuffer data, u32 flags) {
+        ScopedCommandStat stat(this, Command::Send);
         LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Send: fd=%d, size=%zu, flags=0x%x", fd, data.GetSize(), flags);
 
-        std::scoped_lock lk(socket_map_mutex);
-        SocketEntry* entry = GetSocketEntry(fd);
-
-        if (entry && entry->type == SocketType::Virtual) {
+        if (IsVirtualSocket(fd)) {
             if (!EnsureProxyAvailable(out_ret, out_errno, "Send")) {
                 return ResultSuccess();
             }
 
-            ryuldn::proxy::LdnProxySocket* vsock = GetVirtualSocket(fd);
+            auto vsock = AcquireVirtualSocket(fd);
+            errno = 0;
             if (vsock) {
                 s32 sent = vsock->Send(reinterpret_cast<const u8*>(data.GetPointer()), data.GetSize(), flags);
                 if (sent >= 0) {
@@ -649,43 +944,18 @@ namespace ams::mitm::ldn {
 
             // Can't send without destination for UDP or send failed
             out_ret.SetValue(-1);
-            out_errno.SetValue(ENOTCONN);
+            out_errno.SetValue(errno != 0 ? errno : ENOTCONN);
             return ResultSuccess();
         }
 
-        // Normal send - forward to real BSD service
-        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Forwarding Send to real BSD: fd=%d, size=%zu", fd, data.GetSize());
-        struct {
-            s32 fd;
-            u32 flags;
-        } in_args = { fd, flags };
-
-        struct {
-            s32 ret;
-            u32 errno_val;
-        } out_args = {};
-
-        Result rc = serviceDispatchInOut(m_forward_service.get(), 10, in_args, out_args,
-            .buffer_attrs = { SfBufferAttr_In | SfBufferAttr_HipcMapAlias },
-            .buffers = { { data.GetPointer(), data.GetSize() } },
-        );
-
-        if (R_SUCCEEDED(rc)) {
-            out_ret.SetValue(out_args.ret);
-            out_errno.SetValue(out_args.errno_val);
-            if (out_args.ret >= 0) {
-                LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "NET Send fd=%d bytes=%d", fd, out_args.ret);
-            } else {
-                LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "NET Send fd=%d err=%d (%d)", fd, out_args.errno_val);
-            }
-        } else {
-            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Send IPC failed: rc=0x%x", rc.GetValue());
-        }
-        return rc;
+        // Not ours: hand the untouched request back to bsd through the mitm framework
+        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Send: forwarding fd=%d", fd);
+        return sm::mitm::ResultShouldForwardToSession();
     }
 
     Result BsdMitmService::SendTo(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd,
                                    sf::InAutoSelectBuffer data, u32 flags, sf::InAutoSelectBuffer addr) {
+        ScopedCommandStat stat(this, Command::SendTo);
         LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "SendTo: fd=%d, size=%zu, flags=0x%x, addr_size=%zu",
                  fd, data.GetSize(), flags, addr.GetSize());
 
@@ -705,11 +975,9 @@ namespace ams::mitm::ldn {
                         return ResultSuccess();
                     }
 
-                    ryuldn::proxy::LdnProxySocket* vsock = nullptr;
-                    {
-                        std::scoped_lock lk(socket_map_mutex);
-                        vsock = GetVirtualSocket(fd);
-                    }
+                    // A socket sending into the virtual network receives from it as well
+                    auto vsock = MarkVirtual(fd);
+                    errno = 0;
 
                     if (vsock) {
                         s32 sent = vsock->SendTo(reinterpret_cast<const u8*>(data.GetPointer()), data.GetSize(), 0, dest);
@@ -724,9 +992,10 @@ namespace ams::mitm::ldn {
                     LOG_WARN(COMP_BSD_MITM_SVC, "Proxy SendTo failed: virtual socket send error");
 
                     // Failed
+                    const int send_errno = errno != 0 ? errno : EHOSTUNREACH;
                     out_ret.SetValue(-1);
-                    out_errno.SetValue(EHOSTUNREACH);
-                    LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "[NET] fd=%d err=%d: Virtual SendTo failed", fd, EHOSTUNREACH);
+                    out_errno.SetValue(send_errno);
+                    LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "[NET] fd=%d err=%d: Virtual SendTo failed", fd, send_errno);
                     return ResultSuccess();
                 }
             }
@@ -734,54 +1003,29 @@ namespace ams::mitm::ldn {
             LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "SendTo: addr buffer size %zu < sizeof(sockaddr_in)", addr.GetSize());
         }
 
-        // Normal sendto - forward to real BSD service
-        LOG_TRACE(COMP_BSD_MITM_SVC, "Forwarding SendTo to real BSD");
-        struct {
-            s32 fd;
-            u32 flags;
-        } in_args = { fd, flags };
-
-        struct {
-            s32 ret;
-            u32 errno_val;
-        } out_args = {};
-
-        Result rc = serviceDispatchInOut(m_forward_service.get(), 11, in_args, out_args,
-            .buffer_attrs = { SfBufferAttr_In | SfBufferAttr_HipcMapAlias, SfBufferAttr_In | SfBufferAttr_HipcMapAlias },
-            .buffers = { { data.GetPointer(), data.GetSize() }, { addr.GetPointer(), addr.GetSize() } },
-        );
-
-        if (R_SUCCEEDED(rc)) {
-            out_ret.SetValue(out_args.ret);
-            out_errno.SetValue(out_args.errno_val);
-            if (out_args.ret >= 0) {
-                LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "[NET] SendTo fd=%d bytes=%d", fd, out_args.ret);
-            } else {
-                LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "[NET] fd=%d err=%d: SendTo failed", fd, out_args.errno_val);
-            }
-        } else {
-            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "SendTo IPC failed: rc=0x%x", rc.GetValue());
-        }
-        return rc;
+        // Not ours: hand the untouched request back to bsd through the mitm framework
+        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "SendTo: forwarding fd=%d", fd);
+        return sm::mitm::ResultShouldForwardToSession();
     }
 
     Result BsdMitmService::Recv(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, sf::OutAutoSelectBuffer buf, u32 flags) {
+        ScopedCommandStat stat(this, Command::Recv);
         LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Recv: fd=%d, buf_size=%zu, flags=0x%x", fd, buf.GetSize(), flags);
 
-        std::scoped_lock lk(socket_map_mutex);
-        SocketEntry* entry = GetSocketEntry(fd);
-
-        if (entry && entry->type == SocketType::Virtual) {
+        // The handle keeps the socket alive without holding the table lock across a blocking receive
+        if (IsVirtualSocket(fd)) {
             if (!EnsureProxyAvailable(out_ret, out_errno, "Recv")) {
                 return ResultSuccess();
             }
             LOG_TRACE(COMP_BSD_MITM_SVC, "Recv on virtual socket via proxy");
             // Recv() without address buffer - receive via proxy
-            ryuldn::proxy::LdnProxySocket* vsock = GetVirtualSocket(fd);
+            auto vsock = AcquireVirtualSocket(fd);
+            errno = 0;
             if (vsock) {
                 s32 received = vsock->Receive(reinterpret_cast<u8*>(buf.GetPointer()), buf.GetSize(), flags);
 
-                if (received > 0) {
+                // 0 is end of stream (peer closed or read side shut down), not an error
+                if (received >= 0) {
                     out_ret.SetValue(received);
                     out_errno.SetValue(0);
                     LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "[NET] Recv fd=%d bytes=%d", fd, received);
@@ -790,53 +1034,26 @@ namespace ams::mitm::ldn {
                 }
             }
 
-            // No data available
-            LOG_TRACE(COMP_BSD_MITM_SVC, "Recv virtual: no data (EWOULDBLOCK)");
+            // No data available, timed out or reset
+            const int recv_errno = errno != 0 ? errno : EWOULDBLOCK;
+            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Recv virtual: failed (errno=%d)", recv_errno);
             out_ret.SetValue(-1);
-            out_errno.SetValue(EWOULDBLOCK);
+            out_errno.SetValue(recv_errno);
             return ResultSuccess();
         }
 
-        // Normal recv - forward to real BSD service
-        LOG_TRACE(COMP_BSD_MITM_SVC, "Forwarding Recv to real BSD");
-        struct {
-            s32 fd;
-            u32 flags;
-        } in_args = { fd, flags };
-
-        struct {
-            s32 ret;
-            u32 errno_val;
-        } out_args = {};
-
-        Result rc = serviceDispatchInOut(m_forward_service.get(), 8, in_args, out_args,
-            .buffer_attrs = { SfBufferAttr_Out | SfBufferAttr_HipcMapAlias },
-            .buffers = { { buf.GetPointer(), buf.GetSize() } },
-        );
-
-        if (R_SUCCEEDED(rc)) {
-            out_ret.SetValue(out_args.ret);
-            out_errno.SetValue(out_args.errno_val);
-            if (out_args.ret >= 0) {
-                LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "[NET] Recv fd=%d bytes=%d", fd, out_args.ret);
-            } else if (out_args.errno_val != EWOULDBLOCK && out_args.errno_val != EAGAIN) {
-                LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "[NET] fd=%d err=%d: Recv failed", fd, out_args.errno_val);
-            }
-        } else {
-            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Recv IPC failed: rc=0x%x", rc.GetValue());
-        }
-        return rc;
+        // Not ours: hand the untouched request back to bsd through the mitm framework
+        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Recv: forwarding fd=%d", fd);
+        return sm::mitm::ResultShouldForwardToSession();
     }
 
     Result BsdMitmService::RecvFrom(sf::Out<s32> out_ret, sf::Out<u32> out_errno, sf::Out<u32> out_addrlen,
                                      s32 fd, sf::OutAutoSelectBuffer buf, u32 flags, sf::OutAutoSelectBuffer addr) {
+        ScopedCommandStat stat(this, Command::RecvFrom);
         LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "RecvFrom: fd=%d, buf_size=%zu, flags=0x%x, addr_size=%zu",
                  fd, buf.GetSize(), flags, addr.GetSize());
 
-        std::scoped_lock lk(socket_map_mutex);
-        SocketEntry* entry = GetSocketEntry(fd);
-
-        if (entry && entry->type == SocketType::Virtual) {
+        if (IsVirtualSocket(fd)) {
             if (!EnsureProxyAvailable(out_ret, out_errno, "RecvFrom")) {
                 out_addrlen.SetValue(0);
                 return ResultSuccess();
@@ -850,11 +1067,12 @@ namespace ams::mitm::ldn {
                 LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "RecvFrom virtual: addr buffer too small (%zu bytes)", addr.GetSize());
             }
 
-            ryuldn::proxy::LdnProxySocket* vsock = GetVirtualSocket(fd);
+            auto vsock = AcquireVirtualSocket(fd);
+            errno = 0;
             if (vsock) {
                 s32 received = vsock->ReceiveFrom(reinterpret_cast<u8*>(buf.GetPointer()), buf.GetSize(), flags, src_addr);
 
-                if (received > 0) {
+                if (received >= 0) {
                     out_ret.SetValue(received);
                     out_errno.SetValue(0);
                     out_addrlen.SetValue(sizeof(sockaddr_in));
@@ -869,74 +1087,38 @@ namespace ams::mitm::ldn {
                 }
             }
 
-            // No data available
-            LOG_TRACE(COMP_BSD_MITM_SVC, "RecvFrom virtual: no data (EWOULDBLOCK)");
+            // No data available, timed out or reset
+            const int recv_errno = errno != 0 ? errno : EWOULDBLOCK;
+            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "RecvFrom virtual: failed (errno=%d)", recv_errno);
             out_ret.SetValue(-1);
-            out_errno.SetValue(EWOULDBLOCK);
+            out_errno.SetValue(recv_errno);
             out_addrlen.SetValue(0);
             return ResultSuccess();
         }
 
-        // Normal recvfrom - forward to real BSD service
-        LOG_TRACE(COMP_BSD_MITM_SVC, "Forwarding RecvFrom to real BSD");
-        struct {
-            s32 fd;
-            u32 flags;
-        } in_args = { fd, flags };
-
-        struct {
-            s32 ret;
-            u32 errno_val;
-            u32 addrlen;
-        } out_args = {};
-
-        Result rc = serviceDispatchInOut(m_forward_service.get(), 9, in_args, out_args,
-            .buffer_attrs = { SfBufferAttr_Out | SfBufferAttr_HipcMapAlias, SfBufferAttr_Out | SfBufferAttr_HipcMapAlias },
-            .buffers = { { buf.GetPointer(), buf.GetSize() }, { addr.GetPointer(), addr.GetSize() } },
-        );
-
-        if (R_SUCCEEDED(rc)) {
-            out_ret.SetValue(out_args.ret);
-            out_errno.SetValue(out_args.errno_val);
-            out_addrlen.SetValue(out_args.addrlen);
-            if (out_args.ret >= 0) {
-                LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "[NET] RecvFrom fd=%d bytes=%d", fd, out_args.ret);
-            } else if (out_args.errno_val != EWOULDBLOCK && out_args.errno_val != EAGAIN) {
-                LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "[NET] fd=%d err=%d: RecvFrom failed", fd, out_args.errno_val);
-            }
-        } else {
-            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "RecvFrom IPC failed: rc=0x%x", rc.GetValue());
-        }
-        return rc;
+        // Not ours: hand the untouched request back to bsd through the mitm framework
+        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "RecvFrom: forwarding fd=%d", fd);
+        return sm::mitm::ResultShouldForwardToSession();
     }
 
     Result BsdMitmService::Close(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd) {
+        ScopedCommandStat stat(this, Command::Close);
         LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "Close request: fd=%d", fd);
 
+        VirtualSocketRef vsock;
         {
-            std::scoped_lock lk(socket_map_mutex);
+            std::scoped_lock lk(socket_map_lock);
             SocketEntry* entry = GetSocketEntry(fd);
 
             if (entry && entry->type == SocketType::Virtual) {
                 LOG_INFO_ARGS(COMP_BSD_MITM_SVC, "BSD Close VIRTUAL socket: fd=%d", fd);
 
-                // Notify proxy to clean up state for this FD
-                if (s_proxy) {
-                    LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "Notifying proxy to cleanup socket fd=%d", fd);
-                    s_proxy->CleanupSocket(fd);
-                } else {
-                    LOG_WARN(COMP_BSD_MITM_SVC, "Close virtual socket but no proxy available!");
-                }
-
-                // Delete virtual socket instance
-                auto* vsock = reinterpret_cast<ryuldn::proxy::LdnProxySocket*>(entry->virtual_socket);
-                if (vsock && s_proxy) {
-                    s_proxy->UnregisterSocket(vsock);
-                }
-                delete vsock;
+                // Detach the socket; it is freed once in-flight calls drop their handles
+                vsock = std::move(entry->virtual_socket);
 
                 // Reset entry
                 entry->type = SocketType::Real;
+                virtual_socket_count--;
                 entry->virtual_socket = nullptr;
                 entry->address_family = 0;
                 entry->socket_type = 0;
@@ -945,467 +1127,615 @@ namespace ams::mitm::ldn {
             } else if (entry) {
                 LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "Closing real socket: fd=%d", fd);
             }
-        }
 
-        // Always forward close to real BSD
-        LOG_TRACE(COMP_BSD_MITM_SVC, "Forwarding Close to real BSD");
-        struct {
-            s32 fd;
-        } in_args = { fd };
+            if (entry) {
+                entry->real_fd = -1;
+                entry->generation++;
+            }
+        }
 
-        struct {
-            s32 ret;
-            u32 errno_val;
-        } out_args = {};
-
-        Result rc = serviceDispatchInOut(m_forward_service.get(), 26, in_args, out_args);
-
-        if (R_SUCCEEDED(rc)) {
-            out_ret.SetValue(out_args.ret);
-            out_errno.SetValue(out_args.errno_val);
-            if (out_args.ret == 0) {
-                LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "[NET] Close fd=%d", fd);
-                LOG_INFO_ARGS(COMP_BSD_MITM_SVC, "Close succeeded: fd=%d", fd);
+        if (vsock) {
+            // Notify proxy to clean up state for this FD
+            if (s_proxy) {
+                LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "Notifying proxy to cleanup socket fd=%d", fd);
+                s_proxy->CleanupSocket(fd);
             } else {
-                LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Close failed: fd=%d, ret=%d, errno=%u", fd, out_args.ret, out_args.errno_val);
+                LOG_WARN(COMP_BSD_MITM_SVC, "Close virtual socket but no proxy available!");
             }
-        } else {
-            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Close IPC failed: rc=0x%x", rc.GetValue());
+
+            // Unregisters from the proxy and wakes threads blocked on this socket
+            vsock->Close();
+            vsock.reset();
         }
-        return rc;
+
+        // The real fd exists for virtual sockets too; bsd closes it from the original request
+        AMS_UNUSED(out_ret, out_errno);
+        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Close: forwarding fd=%d", fd);
+        return sm::mitm::ResultShouldForwardToSession();
     }
 
     Result BsdMitmService::Accept(sf::Out<s32> out_ret, sf::Out<u32> out_errno, sf::Out<u32> out_addrlen, s32 fd, sf::OutAutoSelectBuffer addr) {
+        ScopedCommandStat stat(this, Command::Accept);
         LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Accept: fd=%d, addr_size=%zu", fd, addr.GetSize());
 
-        SocketEntry* entry = GetSocketEntry(fd);
-        if (!entry || entry->type == SocketType::Real) {
-            LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "Accept: Invalid fd=%d", fd);
+        if (!IsVirtualSocket(fd)) {
+            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Accept: forwarding real fd=%d", fd);
+            return sm::mitm::ResultShouldForwardToSession();
+        }
+
+        if (!EnsureProxyAvailable(out_ret, out_errno, "Accept")) {
+            out_addrlen.SetValue(0);
+            return ResultSuccess();
+        }
+
+        u32 generation = 0;
+        auto virtual_socket = AcquireVirtualSocket(fd, &generation);
+        if (!virtual_socket) {
+            LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "Accept: Failed to get virtual socket for fd=%d", fd);
+            out_ret.SetValue(-1);
+            out_errno.SetValue(ENOTCONN);
+            out_addrlen.SetValue(0);
+            return ResultSuccess();
+        }
+
+        sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
+        VirtualSocketRef accepted;
+        int result = virtual_socket->BsdAccept(reinterpret_cast<sockaddr*>(&client_addr), &client_len, &accepted);
+
+        if (!IsSameSocket(fd, generation)) {
+            // Listener was closed while blocked in accept; don't register anything for a reused fd
+            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Accept: fd=%d was closed during accept", fd);
             out_ret.SetValue(-1);
             out_errno.SetValue(EBADF);
             out_addrlen.SetValue(0);
             return ResultSuccess();
+        } else if (result < 0) {
+            LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "Accept failed: errno=%d", errno);
+            out_ret.SetValue(-1);
+            out_errno.SetValue(errno);
+            out_addrlen.SetValue(0);
+            return ResultSuccess();
         }
 
-        if (entry->type == SocketType::Virtual) {
-            if (!EnsureProxyAvailable(out_ret, out_errno, "Accept")) {
-                out_addrlen.SetValue(0);
-                return ResultSuccess();
+        // Like Socket(), every virtual socket is backed by a real fd so the number is unique
+        // process-wide and Close can be forwarded
+        struct {
+            u32 domain;
+            u32 type;
+            u32 protocol;
+        } in_args = { static_cast<u32>(accepted->GetAddressFamily()), static_cast<u32>(accepted->GetSocketType()), static_cast<u32>(accepted->GetProtocolType()) };
+
+        s32 new_fd = -1;
+        Result rc = serviceDispatchInOut(m_forward_service.get(), 2, in_args, new_fd);
+
+        VirtualSocketRef stale;
+        SocketEntry* new_entry = nullptr;
+        if (R_SUCCEEDED(rc) && new_fd >= 0) {
+            std::scoped_lock lk(socket_map_lock);
+            new_entry = CreateSocketEntry(new_fd);
+            if (new_entry) {
+                stale = std::move(new_entry->virtual_socket);
+                if (new_entry->type != SocketType::Virtual) {
+                    virtual_socket_count++;
+                }
+                new_entry->type = SocketType::Virtual;
+                new_entry->real_fd = new_fd;
+                new_entry->virtual_socket = accepted;
+                new_entry->generation++;
+                new_entry->address_family = in_args.domain;
+                new_entry->socket_type = in_args.type;
+                new_entry->protocol_type = in_args.protocol;
             }
+        }
 
-            auto virtual_socket = GetVirtualSocket(fd);
-            if (!virtual_socket) {
-                LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "Accept: Failed to get virtual socket for fd=%d", fd);
-                out_ret.SetValue(-1);
-                out_errno.SetValue(ENOTCONN);
-                out_addrlen.SetValue(0);
-                return ResultSuccess();
+        if (!new_entry) {
+            LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "Accept: no fd for the accepted connection (rc=0x%x, fd=%d)", rc.GetValue(), new_fd);
+            accepted->Close();
+            if (R_SUCCEEDED(rc) && new_fd >= 0) {
+                const s32 close_fd = new_fd;
+                struct { s32 ret; u32 err; } close_out = {};
+                serviceDispatchInOut(m_forward_service.get(), 26, close_fd, close_out);
             }
+            out_ret.SetValue(-1);
+            out_errno.SetValue(ENFILE);
+            out_addrlen.SetValue(0);
+            return ResultSuccess();
+        }
 
-            sockaddr_in client_addr;
-            socklen_t client_len = sizeof(client_addr);
-            int new_fd = virtual_socket->BsdAccept(reinterpret_cast<sockaddr*>(&client_addr), &client_len);
+        LOG_INFO_ARGS(COMP_BSD_MITM_SVC, "Accept succeeded: fd=%d -> new_fd=%d", fd, new_fd);
+        out_ret.SetValue(new_fd);
+        out_errno.SetValue(0);
+        out_addrlen.SetValue(client_len);
 
-            if (new_fd < 0) {
-                LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Accept failed: errno=%d", errno);
-                out_ret.SetValue(-1);
-                out_errno.SetValue(errno);
-                out_addrlen.SetValue(0);
-            } else {
-                LOG_INFO_ARGS(COMP_BSD_MITM_SVC, "Accept succeeded: new_fd=%d", new_fd);
-                out_ret.SetValue(new_fd);
-                out_errno.SetValue(0);
-                out_addrlen.SetValue(client_len);
-                
-                if (addr.GetSize() >= client_len) {
-                    std::memcpy(addr.GetPointer(), &client_addr, client_len);
-                }
+        if (addr.GetSize() >= client_len) {
+            std::memcpy(addr.GetPointer(), &client_addr, client_len);
+        }
+        return ResultSuccess();
+    }
 
-                // Register new virtual socket
-                SocketEntry* new_entry = GetSocketEntry(new_fd);
-                if (new_entry) {
-                    new_entry->type = SocketType::Virtual;
-                    new_entry->address_family = entry->address_family;
-                    new_entry->socket_type = entry->socket_type;
-                    new_entry->protocol_type = entry->protocol_type;
-                }
-            }
-            return ResultSuccess();
+    Result BsdMitmService::GetPeerName(sf::Out<s32> out_ret, sf::Out<u32> out_errno, sf::Out<u32> out_addrlen, s32 fd, sf::OutAutoSelectBuffer addr) {
+        ScopedCommandStat stat(this, Command::GetPeerName);
+        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "GetPeerName: fd=%d, addr_size=%zu", fd, addr.GetSize());
+
+        if (!IsVirtualSocket(fd)) {
+            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "GetPeerName: forwarding real fd=%d", fd);
+            return sm::mitm::ResultShouldForwardToSession();
         }
 
-        // Forward to real BSD service
-        struct {
-            s32 ret;
-            u32 errno_val;
-            u32 addrlen;
-        } out_args;
+        auto virtual_socket = AcquireVirtualSocket(fd);
+        if (!virtual_socket) {
+            out_ret.SetValue(-1);
+            out_errno.SetValue(ENOTCONN);
+            out_addrlen.SetValue(0);
+            return ResultSuccess();
+        }
 
-        struct {
-            s32 fd;
-        } in_args = { fd };
-
-        Result rc = serviceDispatchInOut(
-            this->m_forward_service.get(),
-            12,
-            in_args,
-            out_args,
-            .buffer_attrs = { SfBufferAttr_HipcAutoSelect | SfBufferAttr_Out },
-            .buffers = { { addr.GetPointer(), addr.GetSize() } }
-        );
-
-        if (R_SUCCEEDED(rc)) {
-            out_ret.SetValue(out_args.ret);
-            out_errno.SetValue(out_args.errno_val);
-            out_addrlen.SetValue(out_args.addrlen);
-            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Accept forwarded: ret=%d, errno=%u", out_args.ret, out_args.errno_val);
+        socklen_t addrlen = addr.GetSize();
+        if (virtual_socket->BsdGetPeerName(reinterpret_cast<sockaddr*>(addr.GetPointer()), &addrlen) < 0) {
+            out_ret.SetValue(-1);
+            out_errno.SetValue(errno);
+            out_addrlen.SetValue(0);
         } else {
-            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Accept IPC failed: rc=0x%x", rc.GetValue());
+            out_ret.SetValue(0);
+            out_errno.SetValue(0);
+            out_addrlen.SetValue(addrlen);
         }
-        return rc;
+        return ResultSuccess();
     }
 
-    Result BsdMitmService::GetSockOpt(sf::Out<s32> out_ret, sf::Out<u32> out_errno, sf::Out<u32> out_optlen, s32 fd, s32 level, s32 optname, sf::OutAutoSelectBuffer optval) {
-        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "GetSockOpt: fd=%d, level=%d, optname=%d", fd, level, optname);
+    Result BsdMitmService::GetSockName(sf::Out<s32> out_ret, sf::Out<u32> out_errno, sf::Out<u32> out_addrlen, s32 fd, sf::OutAutoSelectBuffer addr) {
+        ScopedCommandStat stat(this, Command::GetSockName);
+        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "GetSockName: fd=%d, addr_size=%zu", fd, addr.GetSize());
 
-        SocketEntry* entry = GetSocketEntry(fd);
-        if (!entry || entry->type == SocketType::Real) {
-            LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "GetSockOpt: Invalid fd=%d", fd);
+        if (!IsVirtualSocket(fd)) {
+            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "GetSockName: forwarding real fd=%d", fd);
+            return sm::mitm::ResultShouldForwardToSession();
+        }
+
+        auto virtual_socket = AcquireVirtualSocket(fd);
+        if (!virtual_socket) {
             out_ret.SetValue(-1);
             out_errno.SetValue(EBADF);
-            out_optlen.SetValue(0);
+            out_addrlen.SetValue(0);
             return ResultSuccess();
         }
 
-        if (entry->type == SocketType::Virtual) {
-            if (!EnsureProxyAvailable(out_ret, out_errno, "GetSockOpt")) {
-                out_optlen.SetValue(0);
-                return ResultSuccess();
-            }
+        socklen_t addrlen = addr.GetSize();
+        virtual_socket->BsdGetSockName(reinterpret_cast<sockaddr*>(addr.GetPointer()), &addrlen);
+        out_ret.SetValue(0);
+        out_errno.SetValue(0);
+        out_addrlen.SetValue(addrlen);
+        return ResultSuccess();
+    }
 
-            auto virtual_socket = GetVirtualSocket(fd);
-            if (!virtual_socket) {
-                LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "GetSockOpt: Failed to get virtual socket for fd=%d", fd);
-                out_ret.SetValue(-1);
-                out_errno.SetValue(ENOTCONN);
-                out_optlen.SetValue(0);
-                return ResultSuccess();
-            }
+    Result BsdMitmService::GetSockOpt(sf::Out<s32> out_ret, sf::Out<u32> out_errno, sf::Out<u32> out_optlen, s32 fd, s32 level, s32 optname, sf::OutAutoSelectBuffer optval) {
+        ScopedCommandStat stat(this, Command::GetSockOpt);
+        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "GetSockOpt: fd=%d, level=%d, optname=%d", fd, level, optname);
 
-            socklen_t len = static_cast<socklen_t>(optval.GetSize());
-            int result = virtual_socket->BsdGetSocketOption(level, optname, optval.GetPointer(), &len);
+        if (!IsVirtualSocket(fd)) {
+            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "GetSockOpt: forwarding real fd=%d", fd);
+            return sm::mitm::ResultShouldForwardToSession();
+        }
 
-            if (result < 0) {
-                LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "GetSockOpt failed: errno=%d", errno);
-                out_ret.SetValue(-1);
-                out_errno.SetValue(errno);
-                out_optlen.SetValue(0);
-            } else {
-                out_ret.SetValue(0);
-                out_errno.SetValue(0);
-                out_optlen.SetValue(len);
-                LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "GetSockOpt succeeded: optlen=%u", len);
-            }
+        if (!EnsureProxyAvailable(out_ret, out_errno, "GetSockOpt")) {
+            out_optlen.SetValue(0);
             return ResultSuccess();
         }
 
-        // Forward to real BSD service
-        struct {
-            s32 ret;
-            u32 errno_val;
-            u32 optlen;
-        } out_args;
+        auto virtual_socket = AcquireVirtualSocket(fd);
+        if (!virtual_socket) {
+            LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "GetSockOpt: Failed to get virtual socket for fd=%d", fd);
+            out_ret.SetValue(-1);
+            out_errno.SetValue(ENOTCONN);
+            out_optlen.SetValue(0);
+            return ResultSuccess();
+        }
 
-        struct {
-            s32 fd;
-            s32 level;
-            s32 optname;
-        } in_args = { fd, level, optname };
-
-        Result rc = serviceDispatchInOut(
-            this->m_forward_service.get(),
-            17,
-            in_args,
-            out_args,
-            .buffer_attrs = { SfBufferAttr_HipcAutoSelect | SfBufferAttr_Out },
-            .buffers = { { optval.GetPointer(), optval.GetSize() } }
-        );
-
-        if (R_SUCCEEDED(rc)) {
-            out_ret.SetValue(out_args.ret);
-            out_errno.SetValue(out_args.errno_val);
-            out_optlen.SetValue(out_args.optlen);
-            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "GetSockOpt forwarded: ret=%d, errno=%u", out_args.ret, out_args.errno_val);
+        socklen_t len = static_cast<socklen_t>(optval.GetSize());
+        int result = virtual_socket->BsdGetSocketOption(level, optname, optval.GetPointer(), &len);
+
+        if (result < 0) {
+            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "GetSockOpt failed: errno=%d", errno);
+            out_ret.SetValue(-1);
+            out_errno.SetValue(errno);
+            out_optlen.SetValue(0);
         } else {
-            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "GetSockOpt IPC failed: rc=0x%x", rc.GetValue());
+            out_ret.SetValue(0);
+            out_errno.SetValue(0);
+            out_optlen.SetValue(len);
+            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "GetSockOpt succeeded: optlen=%u", len);
         }
-        return rc;
+        return ResultSuccess();
     }
 
     Result BsdMitmService::Listen(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, s32 backlog) {
+        ScopedCommandStat stat(this, Command::Listen);
         LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Listen: fd=%d, backlog=%d", fd, backlog);
 
-        SocketEntry* entry = GetSocketEntry(fd);
-        if (!entry || entry->type == SocketType::Real) {
-            LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "Listen: Invalid fd=%d", fd);
+        if (!IsVirtualSocket(fd)) {
+            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Listen: forwarding real fd=%d", fd);
+            return sm::mitm::ResultShouldForwardToSession();
+        }
+
+        if (!EnsureProxyAvailable(out_ret, out_errno, "Listen")) {
+            return ResultSuccess();
+        }
+
+        auto virtual_socket = AcquireVirtualSocket(fd);
+        if (!virtual_socket) {
+            LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "Listen: Failed to get virtual socket for fd=%d", fd);
+            out_ret.SetValue(-1);
+            out_errno.SetValue(ENOTCONN);
+            return ResultSuccess();
+        }
+
+        int result = virtual_socket->BsdListen(backlog);
+
+        if (result < 0) {
+            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Listen failed: errno=%d", errno);
+            out_ret.SetValue(-1);
+            out_errno.SetValue(errno);
+        } else {
+            LOG_INFO_ARGS(COMP_BSD_MITM_SVC, "Listen succeeded: fd=%d", fd);
+            out_ret.SetValue(0);
+            out_errno.SetValue(0);
+        }
+        return ResultSuccess();
+    }
+
+    Result BsdMitmService::Ioctl(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, u32 request, u32 bufcount,
+                                  sf::InAutoSelectBuffer in0, sf::InAutoSelectBuffer in1, sf::InAutoSelectBuffer in2, sf::InAutoSelectBuffer in3,
+                                  sf::OutAutoSelectBuffer out0, sf::OutAutoSelectBuffer out1, sf::OutAutoSelectBuffer out2, sf::OutAutoSelectBuffer out3) {
+        ScopedCommandStat stat(this, Command::Ioctl);
+        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Ioctl: fd=%d, request=0x%08x, bufcount=%u", fd, request, bufcount);
+        AMS_UNUSED(in1, in2, in3, out1, out2, out3);
+
+        if (!IsVirtualSocket(fd)) {
+            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Ioctl: forwarding real fd=%d", fd);
+            return sm::mitm::ResultShouldForwardToSession();
+        }
+
+        auto virtual_socket = AcquireVirtualSocket(fd);
+        if (!virtual_socket) {
             out_ret.SetValue(-1);
             out_errno.SetValue(EBADF);
             return ResultSuccess();
         }
 
-        if (entry->type == SocketType::Virtual) {
-            if (!EnsureProxyAvailable(out_ret, out_errno, "Listen")) {
-                return ResultSuccess();
-            }
+        // Socket ioctls take a single int: FIONBIO reads it from the in buffer, FIONREAD writes it to the out buffer
+        s32 value = 0;
+        if (in0.GetSize() >= sizeof(value)) {
+            std::memcpy(&value, in0.GetPointer(), sizeof(value));
+        }
 
-            auto virtual_socket = GetVirtualSocket(fd);
-            if (!virtual_socket) {
-                LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "Listen: Failed to get virtual socket for fd=%d", fd);
-                out_ret.SetValue(-1);
-                out_errno.SetValue(ENOTCONN);
-                return ResultSuccess();
+        if (virtual_socket->BsdIoctl(request, &value) < 0) {
+            if (errno == ENOTTY) {
+                // Not a per-socket request we model (interface queries etc.); the real fd answers it
+                LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Ioctl: forwarding request=0x%08x for virtual fd=%d", request, fd);
+                return sm::mitm::ResultShouldForwardToSession();
             }
+            out_ret.SetValue(-1);
+            out_errno.SetValue(errno);
+            return ResultSuccess();
+        }
+
+        if (out0.GetSize() >= sizeof(value)) {
+            std::memcpy(out0.GetPointer(), &value, sizeof(value));
+        }
+        out_ret.SetValue(0);
+        out_errno.SetValue(0);
+        return ResultSuccess();
+    }
 
-            int result = virtual_socket->BsdListen(backlog);
+    Result BsdMitmService::Fcntl(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, s32 cmd, s32 flags) {
+        ScopedCommandStat stat(this, Command::Fcntl);
+        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Fcntl: fd=%d, cmd=%d, flags=0x%x", fd, cmd, flags);
 
-            if (result < 0) {
-                LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Listen failed: errno=%d", errno);
-                out_ret.SetValue(-1);
-                out_errno.SetValue(errno);
-            } else {
-                LOG_INFO_ARGS(COMP_BSD_MITM_SVC, "Listen succeeded: fd=%d", fd);
-                out_ret.SetValue(0);
-                out_errno.SetValue(0);
-            }
+        if (!IsVirtualSocket(fd)) {
+            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Fcntl: forwarding real fd=%d", fd);
+            return sm::mitm::ResultShouldForwardToSession();
+        }
+
+        if (!EnsureProxyAvailable(out_ret, out_errno, "Fcntl")) {
             return ResultSuccess();
         }
 
-        // Forward to real BSD service
-        struct {
-            s32 ret;
-            u32 errno_val;
-        } out_args;
+        auto virtual_socket = AcquireVirtualSocket(fd);
+        if (!virtual_socket) {
+            LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "Fcntl: Failed to get virtual socket for fd=%d", fd);
+            out_ret.SetValue(-1);
+            out_errno.SetValue(ENOTCONN);
+            return ResultSuccess();
+        }
 
-        struct {
-            s32 fd;
-            s32 backlog;
-        } in_args = { fd, backlog };
-
-        Result rc = serviceDispatchInOut(
-            this->m_forward_service.get(),
-            18,
-            in_args,
-            out_args
-        );
-
-        if (R_SUCCEEDED(rc)) {
-            out_ret.SetValue(out_args.ret);
-            out_errno.SetValue(out_args.errno_val);
-            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Listen forwarded: ret=%d, errno=%u", out_args.ret, out_args.errno_val);
+        int result = virtual_socket->BsdFcntl(cmd, flags);
+
+        if (result < 0) {
+            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Fcntl failed: errno=%d", errno);
+            out_ret.SetValue(-1);
+            out_errno.SetValue(errno);
         } else {
-            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Listen IPC failed: rc=0x%x", rc.GetValue());
+            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Fcntl succeeded: result=%d", result);
+            out_ret.SetValue(result);
+            out_errno.SetValue(0);
         }
-        return rc;
+        return ResultSuccess();
     }
 
-    Result BsdMitmService::Fcntl(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, s32 cmd, s32 flags) {
-        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Fcntl: fd=%d, cmd=%d, flags=0x%x", fd, cmd, flags);
+    Result BsdMitmService::SetSockOpt(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, s32 level, s32 optname, sf::InAutoSelectBuffer optval) {
+        ScopedCommandStat stat(this, Command::SetSockOpt);
+        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "SetSockOpt: fd=%d, level=%d, optname=%d", fd, level, optname);
 
-        SocketEntry* entry = GetSocketEntry(fd);
-        if (!entry || entry->type == SocketType::Real) {
-            LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "Fcntl: Invalid fd=%d", fd);
+        if (!IsVirtualSocket(fd)) {
+            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "SetSockOpt: forwarding real fd=%d", fd);
+            return sm::mitm::ResultShouldForwardToSession();
+        }
+
+        if (!EnsureProxyAvailable(out_ret, out_errno, "SetSockOpt")) {
+            return ResultSuccess();
+        }
+
+        auto virtual_socket = AcquireVirtualSocket(fd);
+        if (!virtual_socket) {
+            LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "SetSockOpt: Failed to get virtual socket for fd=%d", fd);
             out_ret.SetValue(-1);
-            out_errno.SetValue(EBADF);
+            out_errno.SetValue(ENOTCONN);
             return ResultSuccess();
         }
 
-        if (entry->type == SocketType::Virtual) {
-            if (!EnsureProxyAvailable(out_ret, out_errno, "Fcntl")) {
-                return ResultSuccess();
-            }
+        int result = virtual_socket->BsdSetSocketOption(level, optname, optval.GetPointer(), static_cast<socklen_t>(optval.GetSize()));
 
-            auto virtual_socket = GetVirtualSocket(fd);
-            if (!virtual_socket) {
-                LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "Fcntl: Failed to get virtual socket for fd=%d", fd);
-                out_ret.SetValue(-1);
-                out_errno.SetValue(ENOTCONN);
-                return ResultSuccess();
-            }
+        if (result < 0) {
+            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "SetSockOpt failed: errno=%d", errno);
+            out_ret.SetValue(-1);
+            out_errno.SetValue(errno);
+        } else {
+            LOG_TRACE(COMP_BSD_MITM_SVC, "SetSockOpt succeeded");
+            out_ret.SetValue(0);
+            out_errno.SetValue(0);
+        }
+        return ResultSuccess();
+    }
 
-            int result = virtual_socket->BsdFcntl(cmd, flags);
+    Result BsdMitmService::Shutdown(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, s32 how) {
+        ScopedCommandStat stat(this, Command::Shutdown);
+        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Shutdown: fd=%d, how=%d", fd, how);
 
-            if (result < 0) {
-                LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Fcntl failed: errno=%d", errno);
-                out_ret.SetValue(-1);
-                out_errno.SetValue(errno);
-            } else {
-                LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Fcntl succeeded: result=%d", result);
-                out_ret.SetValue(result);
-                out_errno.SetValue(0);
-            }
+        if (!IsVirtualSocket(fd)) {
+            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Shutdown: forwarding real fd=%d", fd);
+            return sm::mitm::ResultShouldForwardToSession();
+        }
+
+        if (!EnsureProxyAvailable(out_ret, out_errno, "Shutdown")) {
             return ResultSuccess();
         }
 
-        // Forward to real BSD service
-        struct {
-            s32 ret;
-            u32 errno_val;
-        } out_args;
+        auto virtual_socket = AcquireVirtualSocket(fd);
+        if (!virtual_socket) {
+            LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "Shutdown: Failed to get virtual socket for fd=%d", fd);
+            out_ret.SetValue(-1);
+            out_errno.SetValue(ENOTCONN);
+            return ResultSuccess();
+        }
 
-        struct {
-            s32 fd;
-            s32 cmd;
-            s32 flags;
-        } in_args = { fd, cmd, flags };
-
-        Result rc = serviceDispatchInOut(
-            this->m_forward_service.get(),
-            20,
-            in_args,
-            out_args
-        );
-
-        if (R_SUCCEEDED(rc)) {
-            out_ret.SetValue(out_args.ret);
-            out_errno.SetValue(out_args.errno_val);
-            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Fcntl forwarded: ret=%d, errno=%u", out_args.ret, out_args.errno_val);
+        int result = virtual_socket->BsdShutdown(how);
+
+        if (result < 0) {
+            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Shutdown failed: errno=%d", errno);
+            out_ret.SetValue(-1);
+            out_errno.SetValue(errno);
         } else {
-            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Fcntl IPC failed: rc=0x%x", rc.GetValue());
+            LOG_INFO_ARGS(COMP_BSD_MITM_SVC, "Shutdown succeeded: fd=%d, how=%d", fd, how);
+            out_ret.SetValue(0);
+            out_errno.SetValue(0);
         }
-        return rc;
+        return ResultSuccess();
     }
 
-    Result BsdMitmService::SetSockOpt(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, s32 level, s32 optname, sf::InAutoSelectBuffer optval) {
-        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "SetSockOpt: fd=%d, level=%d, optname=%d", fd, level, optname);
+    Result BsdMitmService::RecvMMsg(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, u32 vlen, u32 flags, u32 reserved, BsdTimeVal timeout, sf::OutAutoSelectBuffer msgs) {
+        ScopedCommandStat stat(this, Command::RecvMMsg);
+        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "RecvMMsg: fd=%d, vlen=%u, flags=0x%x, buf_size=%zu", fd, vlen, flags, msgs.GetSize());
+        AMS_UNUSED(reserved);
 
-        SocketEntry* entry = GetSocketEntry(fd);
-        if (!entry || entry->type == SocketType::Real) {
-            LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "SetSockOpt: Invalid fd=%d", fd);
+        if (!IsVirtualSocket(fd)) {
+            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "RecvMMsg: forwarding real fd=%d", fd);
+            return sm::mitm::ResultShouldForwardToSession();
+        }
+
+        // Only the first datagram may block, until the call's timeout or SO_RCVTIMEO, whichever is sooner
+        // (a zero timeval leaves it to the socket); the rest of the batch is whatever is already queued
+        constexpr u64 MaxTimeoutSeconds = 24 * 60 * 60;
+        const TimeSpan call_timeout = TimeSpan::FromSeconds(static_cast<s64>(std::min<u64>(timeout.tv_sec, MaxTimeoutSeconds))) +
+                                      TimeSpan::FromMicroSeconds(static_cast<s64>(std::min<u64>(timeout.tv_usec, 1000000)));
+
+        if (!EnsureProxyAvailable(out_ret, out_errno, "RecvMMsg")) {
+            return ResultSuccess();
+        }
+
+        auto vsock = AcquireVirtualSocket(fd);
+        if (!vsock) {
             out_ret.SetValue(-1);
-            out_errno.SetValue(EBADF);
+            out_errno.SetValue(ENOTCONN);
             return ResultSuccess();
         }
 
-        if (entry->type == SocketType::Virtual) {
-            if (!EnsureProxyAvailable(out_ret, out_errno, "SetSockOpt")) {
-                return ResultSuccess();
+        u8* cursor = reinterpret_cast<u8*>(msgs.GetPointer());
+        const u8* end = cursor + msgs.GetSize();
+        std::optional<ryuldn::ScopedBuffer> scratch;   // Only for messages with several iovecs
+
+        s32 count = 0;
+        u32 error = EWOULDBLOCK;
+        for (u32 i = 0; i < vlen; i++) {
+            SerializedMsgHdr msg;
+            if (!ParseMsgHdr(cursor, end, &msg)) {
+                error = EINVAL;
+                break;
             }
 
-            auto virtual_socket = GetVirtualSocket(fd);
-            if (!virtual_socket) {
-                LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "SetSockOpt: Failed to get virtual socket for fd=%d", fd);
-                out_ret.SetValue(-1);
-                out_errno.SetValue(ENOTCONN);
-                return ResultSuccess();
+            const s32 recv_flags = i == 0 ? flags : (flags | MSG_DONTWAIT);
+            errno = 0;
+            sockaddr_in src_addr;
+            std::memset(&src_addr, 0, sizeof(src_addr));
+
+            s32 received;
+            if (msg.iov_count <= 1) {
+                received = vsock->ReceiveFrom(msg.iov_count ? msg.iov[0] : nullptr, msg.iov_count ? msg.iov_len[0] : 0,
+                                              recv_flags, &src_addr, call_timeout);
+            } else {
+                if (!scratch) {
+                    scratch.emplace(ryuldn::g_sharedBufferPool);
+                }
+                if (!scratch->IsValid()) {
+                    error = ENOMEM;
+                    break;
+                }
+
+                size_t capacity = 0;
+                for (size_t j = 0; j < msg.iov_count; j++) {
+                    capacity += msg.iov_len[j];
+                }
+                received = vsock->ReceiveFrom(scratch->Get(), std::min(capacity, ryuldn::BufferPool::GetBufferSize()),
+                                              recv_flags, &src_addr, call_timeout);
+
+                size_t offset = 0;
+                for (size_t j = 0; j < msg.iov_count && received > 0 && offset < static_cast<size_t>(received); j++) {
+                    const size_t chunk = std::min(msg.iov_len[j], static_cast<size_t>(received) - offset);
+                    std::memcpy(msg.iov[j], scratch->Get() + offset, chunk);
+                    offset += chunk;
+                }
             }
 
-            int result = virtual_socket->BsdSetSocketOption(level, optname, optval.GetPointer(), static_cast<socklen_t>(optval.GetSize()));
+            if (received < 0) {
+                error = errno != 0 ? errno : EWOULDBLOCK;
+                break;
+            }
 
-            if (result < 0) {
-                LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "SetSockOpt failed: errno=%d", errno);
-                out_ret.SetValue(-1);
-                out_errno.SetValue(errno);
-            } else {
-                LOG_TRACE(COMP_BSD_MITM_SVC, "SetSockOpt succeeded");
-                out_ret.SetValue(0);
-                out_errno.SetValue(0);
+            if (msg.name_len > 0) {
+                std::memcpy(msg.name, &src_addr, std::min(msg.name_len, sizeof(src_addr)));
             }
-            return ResultSuccess();
-        }
+            SetMsgLen(msg, received);
+            count++;
 
-        // Forward to real BSD service
-        struct {
-            s32 ret;
-            u32 errno_val;
-        } out_args;
+            if (received == 0) {
+                // Read side shut down
+                break;
+            }
+        }
 
-        struct {
-            s32 fd;
-            s32 level;
-            s32 optname;
-        } in_args = { fd, level, optname };
-
-        Result rc = serviceDispatchInOut(
-            this->m_forward_service.get(),
-            21,
-            in_args,
-            out_args,
-            .buffer_attrs = { SfBufferAttr_HipcAutoSelect | SfBufferAttr_In },
-            .buffers = { { optval.GetPointer(), optval.GetSize() } }
-        );
-
-        if (R_SUCCEEDED(rc)) {
-            out_ret.SetValue(out_args.ret);
-            out_errno.SetValue(out_args.errno_val);
-            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "SetSockOpt forwarded: ret=%d, errno=%u", out_args.ret, out_args.errno_val);
+        if (count > 0) {
+            out_ret.SetValue(count);
+            out_errno.SetValue(0);
+            LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "[NET] RecvMMsg fd=%d msgs=%d", fd, count);
         } else {
-            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "SetSockOpt IPC failed: rc=0x%x", rc.GetValue());
+            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "RecvMMsg virtual: no data (errno=%u)", error);
+            out_ret.SetValue(-1);
+            out_errno.SetValue(error);
         }
-        return rc;
+        return ResultSuccess();
     }
 
-    Result BsdMitmService::Shutdown(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, s32 how) {
-        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Shutdown: fd=%d, how=%d", fd, how);
+    Result BsdMitmService::SendMMsg(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, u32 vlen, u32 flags, sf::OutAutoSelectBuffer msgs) {
+        ScopedCommandStat stat(this, Command::SendMMsg);
+        LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "SendMMsg: fd=%d, vlen=%u, flags=0x%x, buf_size=%zu", fd, vlen, flags, msgs.GetSize());
 
-        SocketEntry* entry = GetSocketEntry(fd);
-        if (!entry || entry->type == SocketType::Real) {
-            LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "Shutdown: Invalid fd=%d", fd);
+        if (!IsVirtualSocket(fd)) {
+            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "SendMMsg: forwarding real fd=%d", fd);
+            return sm::mitm::ResultShouldForwardToSession();
+        }
+
+        if (!EnsureProxyAvailable(out_ret, out_errno, "SendMMsg")) {
+            return ResultSuccess();
+        }
+
+        auto vsock = AcquireVirtualSocket(fd);
+        if (!vsock) {
             out_ret.SetValue(-1);
-            out_errno.SetValue(EBADF);
+            out_errno.SetValue(ENOTCONN);
             return ResultSuccess();
         }
 
-        if (entry->type == SocketType::Virtual) {
-            if (!EnsureProxyAvailable(out_ret, out_errno, "Shutdown")) {
-                return ResultSuccess();
+        // Datagrams are gathered straight out of the IPC buffer and written to the server in batches
+        constexpr size_t BatchSize = 16;
+        ryuldn::proxy::ProxyDatagram batch[BatchSize];
+        SerializedMsgHdr batch_msgs[BatchSize];
+        size_t pending = 0;
+
+        u8* cursor = reinterpret_cast<u8*>(msgs.GetPointer());
+        const u8* end = cursor + msgs.GetSize();
+
+        s32 count = 0;
+        u32 error = 0;
+        // msg_len is only filled in for datagrams that actually went out
+        auto flush = [&]() {
+            errno = 0;
+            s32 sent = vsock->SendToBatch(batch, pending);
+            for (s32 j = 0; j < sent; j++) {
+                size_t total = 0;
+                for (size_t k = 0; k < batch[j].segmentCount; k++) {
+                    total += batch[j].segmentSizes[k];
+                }
+                SetMsgLen(batch_msgs[j], total);
+            }
+            if (sent > 0) {
+                count += sent;
+            }
+            if (sent < static_cast<s32>(pending) && error == 0) {
+                error = errno != 0 ? errno : EHOSTUNREACH;
+            }
+            pending = 0;
+        };
+
+        for (u32 i = 0; i < vlen && error == 0; i++) {
+            SerializedMsgHdr msg;
+            if (!ParseMsgHdr(cursor, end, &msg)) {
+                error = EINVAL;
+                break;
             }
 
-            auto virtual_socket = GetVirtualSocket(fd);
-            if (!virtual_socket) {
-                LOG_ERR_ARGS(COMP_BSD_MITM_SVC, "Shutdown: Failed to get virtual socket for fd=%d", fd);
-                out_ret.SetValue(-1);
-                out_errno.SetValue(ENOTCONN);
-                return ResultSuccess();
+            ryuldn::proxy::ProxyDatagram& datagram = batch[pending];
+            if (msg.name_len >= sizeof(sockaddr_in) && vsock->GetProtocolType() != IPPROTO_TCP) {
+                // Same rule as SendTo: a virtual socket only reaches addresses inside the virtual network
+                std::memcpy(&datagram.dest, msg.name, sizeof(sockaddr_in));
+                if (datagram.dest.sin_family != AF_INET || !IsRyuLdnVirtualIP(ntohl(datagram.dest.sin_addr.s_addr))) {
+                    LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "SendMMsg: fd=%d, destination 0x%08x is outside the virtual network",
+                                  fd, ntohl(datagram.dest.sin_addr.s_addr));
+                    error = EHOSTUNREACH;
+                    break;
+                }
+            } else if (vsock->IsConnected()) {
+                datagram.dest = vsock->GetRemoteEndPoint();
+            } else {
+                error = EDESTADDRREQ;
+                break;
             }
 
-            int result = virtual_socket->BsdShutdown(how);
+            datagram.segmentCount = msg.iov_count;
+            for (size_t j = 0; j < msg.iov_count; j++) {
+                datagram.segments[j] = msg.iov[j];
+                datagram.segmentSizes[j] = msg.iov_len[j];
+            }
+            batch_msgs[pending] = msg;
 
-            if (result < 0) {
-                LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Shutdown failed: errno=%d", errno);
-                out_ret.SetValue(-1);
-                out_errno.SetValue(errno);
-            } else {
-                LOG_INFO_ARGS(COMP_BSD_MITM_SVC, "Shutdown succeeded: fd=%d, how=%d", fd, how);
-                out_ret.SetValue(0);
-                out_errno.SetValue(0);
+            if (++pending == BatchSize) {
+                flush();
             }
-            return ResultSuccess();
         }
 
-        // Forward to real BSD service
-        struct {
-            s32 ret;
-            u32 errno_val;
-        } out_args;
+        // Whatever was gathered before an error still goes out, and is what the call reports
+        if (pending > 0) {
+            flush();
+        }
 
-        struct {
-            s32 fd;
-            s32 how;
-        } in_args = { fd, how };
-
-        Result rc = serviceDispatchInOut(
-            this->m_forward_service.get(),
-            22,
-            in_args,
-            out_args
-        );
-
-        if (R_SUCCEEDED(rc)) {
-            out_ret.SetValue(out_args.ret);
-            out_errno.SetValue(out_args.errno_val);
-            LOG_TRACE_ARGS(COMP_BSD_MITM_SVC, "Shutdown forwarded: ret=%d, errno=%u", out_args.ret, out_args.errno_val);
+        if (count > 0) {
+            out_ret.SetValue(count);
+            out_errno.SetValue(0);
+            LOG_DBG_ARGS(COMP_BSD_MITM_SVC, "[NET] SendMMsg fd=%d msgs=%d", fd, count);
         } else {
-            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "Shutdown IPC failed: rc=0x%x", rc.GetValue());
+            LOG_WARN_ARGS(COMP_BSD_MITM_SVC, "SendMMsg virtual failed: fd=%d, errno=%u", fd, error);
+            out_ret.SetValue(-1);
+            out_errno.SetValue(error ? error : EHOSTUNREACH);
         }
-        return rc;
+        return ResultSuccess();
     }
 }
@@ -3,6 +3,19 @@
 #include <stratosphere.hpp>
 #include "debug.hpp"
 #include "ryuldn/ryuldn.hpp"
+#include "ryuldn/proxy/ldn_proxy_socket_pool.hpp"
+#include <memory>
+#include <atomic>
+
+namespace ams::mitm::ldn {
+
+    // nn::socket::TimeVal, as passed to RecvMMsg
+    struct BsdTimeVal {
+        u64 tv_sec;
+        u64 tv_usec;
+    };
+
+}
 
 // BSD:u IPC command IDs
 #define AMS_BSD_MITM_INTERFACE_INFO(C, H)                                                                  \
@@ -16,12 +29,17 @@
     AMS_SF_METHOD_INFO(C, H, 12, Result, Accept,     (sf::Out<s32> out_ret, sf::Out<u32> out_errno, sf::Out<u32> out_addrlen, s32 fd, sf::OutAutoSelectBuffer addr), (out_ret, out_errno, out_addrlen, fd, addr)) \
     AMS_SF_METHOD_INFO(C, H, 13, Result, Bind,       (sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, sf::InAutoSelectBuffer addr), (out_ret, out_errno, fd, addr)) \
     AMS_SF_METHOD_INFO(C, H, 14, Result, Connect,    (sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, sf::InAutoSelectBuffer addr), (out_ret, out_errno, fd, addr)) \
+    AMS_SF_METHOD_INFO(C, H, 15, Result, GetPeerName, (sf::Out<s32> out_ret, sf::Out<u32> out_errno, sf::Out<u32> out_addrlen, s32 fd, sf::OutAutoSelectBuffer addr), (out_ret, out_errno, out_addrlen, fd, addr)) \
+    AMS_SF_METHOD_INFO(C, H, 16, Result, GetSockName, (sf::Out<s32> out_ret, sf::Out<u32> out_errno, sf::Out<u32> out_addrlen, s32 fd, sf::OutAutoSelectBuffer addr), (out_ret, out_errno, out_addrlen, fd, addr)) \
     AMS_SF_METHOD_INFO(C, H, 17, Result, GetSockOpt, (sf::Out<s32> out_ret, sf::Out<u32> out_errno, sf::Out<u32> out_optlen, s32 fd, s32 level, s32 optname, sf::OutAutoSelectBuffer optval), (out_ret, out_errno, out_optlen, fd, level, optname, optval)) \
     AMS_SF_METHOD_INFO(C, H, 18, Result, Listen,     (sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, s32 backlog), (out_ret, out_errno, fd, backlog)) \
+    AMS_SF_METHOD_INFO(C, H, 19, Result, Ioctl,      (sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, u32 request, u32 bufcount, sf::InAutoSelectBuffer in0, sf::InAutoSelectBuffer in1, sf::InAutoSelectBuffer in2, sf::InAutoSelectBuffer in3, sf::OutAutoSelectBuffer out0, sf::OutAutoSelectBuffer out1, sf::OutAutoSelectBuffer out2, sf::OutAutoSelectBuffer out3), (out_ret, out_errno, fd, request, bufcount, in0, in1, in2, in3, out0, out1, out2, out3)) \
     AMS_SF_METHOD_INFO(C, H, 20, Result, Fcntl,      (sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, s32 cmd, s32 flags), (out_ret, out_errno, fd, cmd, flags)) \
     AMS_SF_METHOD_INFO(C, H, 21, Result, SetSockOpt, (sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, s32 level, s32 optname, sf::InAutoSelectBuffer optval), (out_ret, out_errno, fd, level, optname, optval)) \
     AMS_SF_METHOD_INFO(C, H, 22, Result, Shutdown,   (sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, s32 how), (out_ret, out_errno, fd, how)) \
-    AMS_SF_METHOD_INFO(C, H, 26, Result, Close,      (sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd), (out_ret, out_errno, fd))
+    AMS_SF_METHOD_INFO(C, H, 26, Result, Close,      (sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd), (out_ret, out_errno, fd)) \
+    AMS_SF_METHOD_INFO(C, H, 29, Result, RecvMMsg,   (sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, u32 vlen, u32 flags, u32 reserved, BsdTimeVal timeout, sf::OutAutoSelectBuffer msgs), (out_ret, out_errno, fd, vlen, flags, reserved, timeout, msgs), hos::Version_7_0_0) \
+    AMS_SF_METHOD_INFO(C, H, 30, Result, SendMMsg,   (sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, u32 vlen, u32 flags, sf::OutAutoSelectBuffer msgs), (out_ret, out_errno, fd, vlen, flags, msgs), hos::Version_7_0_0)
 
 AMS_SF_DEFINE_MITM_INTERFACE(ams::mitm::ldn, IBsdMitmInterface, AMS_BSD_MITM_INTERFACE_INFO, 0x4E553516)
 
@@ -34,25 +52,79 @@ namespace ams::mitm::ldn {
             Virtual     // RyuLDN virtual socket
         };
 
+        using VirtualSocketRef = std::shared_ptr<ryuldn::proxy::LdnProxySocket>;
+
         struct SocketEntry {
-            SocketType type;
-            s32 real_fd;           // Real FD (for real sockets)
-            void* virtual_socket;  // VirtualSocket* (for virtual sockets)
-            u32 address_family;
-            u32 socket_type;
-            u32 protocol_type;
+            SocketType type = SocketType::Real;
+            s32 real_fd = -1;                  // Real FD (for real sockets)
+            VirtualSocketRef virtual_socket;   // Shared so Close can't free it under in-flight I/O
+            u32 address_family = 0;
+            u32 socket_type = 0;
+            u32 protocol_type = 0;
+            u32 generation = 0;                // Bumped whenever the fd is (re)opened or closed
         };
 
-        static constexpr size_t MaxSockets = 128;
-        SocketEntry socket_map[MaxSockets];
-        os::Mutex socket_map_mutex;
+        // fd -> entry table, indexed directly by fd
+        // The first chunk is inline so common small fds never touch the heap;
+        // further chunks are allocated the first time an fd in their range is opened
+        static constexpr size_t SocketChunkSize = 128;
+        static constexpr size_t MaxSocketChunks = 32;
+        static constexpr size_t MaxSockets = SocketChunkSize * MaxSocketChunks;
+        SocketEntry socket_map[SocketChunkSize];
+        std::unique_ptr<SocketEntry[]> socket_chunks[MaxSocketChunks];   // [0] unused, covered by socket_map
+        // Guards the table only; never held across a blocking virtual or forwarded call
+        os::ReaderWriterLock socket_map_lock;
+        std::atomic<u32> virtual_socket_count{0};   // Lets real-only processes skip the table
+
+        // Cost of the mitm layer itself per command (classification, table lookups, virtual I/O)
+        // Sampled only at debug log level and logged when the session ends
+        enum class Command : u8 {
+            Socket, Select, Poll, Recv, RecvFrom, Send, SendTo, Accept, Bind, Connect, GetPeerName, GetSockName, GetSockOpt, Listen, Ioctl, Fcntl, SetSockOpt, Shutdown, Close, RecvMMsg, SendMMsg,
+            Count
+        };
+        struct CommandStat {
+            std::atomic<u64> calls{0};
+            std::atomic<u64> ticks{0};
+            std::atomic<u64> max_ticks{0};
+        };
+        class ScopedCommandStat {
+        private:
+            CommandStat* stat;
+            os::Tick start;
+        public:
+            ScopedCommandStat(BsdMitmService* service, Command command);
+            ~ScopedCommandStat();
+        };
+        CommandStat command_stats[static_cast<size_t>(Command::Count)];
+        void LogCommandStats();
 
         static ryuldn::proxy::LdnProxy* s_proxy;
+        static ryuldn::proxy::LdnProxySocketPool s_socket_pool;   // Shared by every bsd:u session
+
+        // Poll keeps its real-fd subset on the stack up to this many entries
+        static constexpr size_t PollScratchCount = 32;
+        static std::atomic<u32> s_scratch_heap_fallbacks;
+
+        // Processes currently holding an ldn:u session; only these (plus config overrides) get mitm'd
+        struct LdnClientEntry {
+            u64 process_id;
+            u32 refs;
+        };
+        static constexpr size_t MaxLdnClients = 8;
+        static LdnClientEntry s_ldn_clients[MaxLdnClients];
+        static os::SdkMutex s_ldn_clients_mutex;
+
+        static bool IsLdnClient(u64 process_id);
 
         SocketEntry* GetSocketEntry(s32 fd);
+        SocketEntry* CreateSocketEntry(s32 fd);
         bool IsRyuLdnVirtualIP(u32 ip);
         bool EnsureProxyAvailable(sf::Out<s32> out_ret, sf::Out<u32> out_errno, const char* context);
-        ryuldn::proxy::LdnProxySocket* GetVirtualSocket(s32 fd);
+        bool IsVirtualSocket(s32 fd);
+        VirtualSocketRef MarkVirtual(s32 fd, u32* out_generation = nullptr);
+        VirtualSocketRef AcquireVirtualSocket(s32 fd, u32* out_generation = nullptr);
+        bool IsSameSocket(s32 fd, u32 generation);
+        VirtualSocketRef GetOrCreateVirtualSocket(SocketEntry* entry);
 
     public:
         BsdMitmService(std::shared_ptr<::Service> &&s, const sm::MitmProcessInfo &c);
@@ -61,8 +133,17 @@ namespace ams::mitm::ldn {
         static bool ShouldMitm(const sm::MitmProcessInfo &client_info);
 
         static void RegisterProxy(ryuldn::proxy::LdnProxy* proxy);
+
+        // Number of Poll calls too large for the inline scratch arrays
+        static u32 GetScratchHeapFallbacks() { return s_scratch_heap_fallbacks.load(std::memory_order_relaxed); }
+        // Number of virtual sockets that had to be allocated because the pool was empty
+        static u32 GetSocketPoolMisses() { return s_socket_pool.GetMissCount(); }
         static void UnregisterProxy();
 
+        // Called by ICommunicationService / IClientProcessMonitor (refcounted per process)
+        static void RegisterLdnClient(u64 process_id);
+        static void UnregisterLdnClient(u64 process_id);
+
         // BSD IPC commands
         Result Socket(sf::Out<s32> out_fd, u32 domain, u32 type, u32 protocol);
         Result Select(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 nfds, sf::InAutoSelectBuffer readfds, sf::InAutoSelectBuffer writefds, sf::InAutoSelectBuffer exceptfds, sf::InAutoSelectBuffer timeout);
@@ -74,12 +155,17 @@ namespace ams::mitm::ldn {
         Result Accept(sf::Out<s32> out_ret, sf::Out<u32> out_errno, sf::Out<u32> out_addrlen, s32 fd, sf::OutAutoSelectBuffer addr);
         Result Bind(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, sf::InAutoSelectBuffer addr);
         Result Connect(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, sf::InAutoSelectBuffer addr);
+        Result GetPeerName(sf::Out<s32> out_ret, sf::Out<u32> out_errno, sf::Out<u32> out_addrlen, s32 fd, sf::OutAutoSelectBuffer addr);
+        Result GetSockName(sf::Out<s32> out_ret, sf::Out<u32> out_errno, sf::Out<u32> out_addrlen, s32 fd, sf::OutAutoSelectBuffer addr);
         Result GetSockOpt(sf::Out<s32> out_ret, sf::Out<u32> out_errno, sf::Out<u32> out_optlen, s32 fd, s32 level, s32 optname, sf::OutAutoSelectBuffer optval);
         Result Listen(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, s32 backlog);
+        Result Ioctl(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, u32 request, u32 bufcount, sf::InAutoSelectBuffer in0, sf::InAutoSelectBuffer in1, sf::InAutoSelectBuffer in2, sf::InAutoSelectBuffer in3, sf::OutAutoSelectBuffer out0, sf::OutAutoSelectBuffer out1, sf::OutAutoSelectBuffer out2, sf::OutAutoSelectBuffer out3);
         Result Fcntl(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, s32 cmd, s32 flags);
         Result SetSockOpt(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, s32 level, s32 optname, sf::InAutoSelectBuffer optval);
         Result Shutdown(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, s32 how);
         Result Close(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd);
+        Result RecvMMsg(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, u32 vlen, u32 flags, u32 reserved, BsdTimeVal timeout, sf::OutAutoSelectBuffer msgs);
+        Result SendMMsg(sf::Out<s32> out_ret, sf::Out<u32> out_errno, s32 fd, u32 vlen, u32 flags, sf::OutAutoSelectBuffer msgs);
     };
 
     static_assert(ams::mitm::ldn::IsIBsdMitmInterface<BsdMitmService>);
@@ -31,6 +31,7 @@ namespace ams::mitm::ldn {
     AMS_SF_METHOD_INFO(C, H, 65010, Result, GetServerPort,      (::ams::sf::Out<u16> port),                              (port))       \
     AMS_SF_METHOD_INFO(C, H, 65011, Result, SetServerPort,      (u16 port),                                              (port))        \
     AMS_SF_METHOD_INFO(C, H, 65012, Result, GetLoggingLevel,    (::ams::sf::Out<u32> level),                             (level))       \
-    AMS_SF_METHOD_INFO(C, H, 65013, Result, SetLoggingLevel,    (u32 level),                                             (level))
+    AMS_SF_METHOD_INFO(C, H, 65013, Result, SetLoggingLevel,    (u32 level),                                             (level))       \
+    AMS_SF_METHOD_INFO(C, H, 65014, Result, GetSocketStats,     (::ams::sf::Out<u32> count, ::ams::sf::OutArray<::RyuLdnSocketStats> stats), (count, stats))
 
 AMS_SF_DEFINE_INTERFACE(ams::mitm::ldn, ILdnConfig, AMS_LDN_CONFIG, 0x14c8af2c)
@@ -15,11 +15,22 @@
  */
 
 #include "ldn_client_process_monitor.hpp"
+#include "bsd_mitm_service.hpp"
 
 namespace ams::mitm::ldn {
-        Result IClientProcessMonitor::RegisterClient([[maybe_unused]] const sf::ClientProcessId &client_process_id) {
-        // Stub pour firmware 18.0.0+ - Pokemon Legends Z-A
-        LOG_DBG(COMP_LDN_MONITOR, "ClientProcessId registered (stub)");
+    IClientProcessMonitor::~IClientProcessMonitor() {
+        if (this->client_process_id != 0) {
+            BsdMitmService::UnregisterLdnClient(this->client_process_id);
+        }
+    }
+
+    Result IClientProcessMonitor::RegisterClient(const sf::ClientProcessId &client_process_id) {
+        // Firmware 18.0.0+ (Pokemon Legends Z-A): the process holding this monitor is an LDN client
+        if (this->client_process_id == 0) {
+            this->client_process_id = client_process_id.GetValue().value;
+            BsdMitmService::RegisterLdnClient(this->client_process_id);
+        }
+        LOG_DBG_ARGS(COMP_LDN_MONITOR, "ClientProcessId registered: pid=%" PRIu64, this->client_process_id);
         return ResultSuccess();
     }
 }
\ No newline at end of file
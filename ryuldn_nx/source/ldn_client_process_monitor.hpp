@@ -22,7 +22,11 @@
 
 namespace ams::mitm::ldn {
     class IClientProcessMonitor {
+        private:
+            u64 client_process_id = 0;
         public:
+            ~IClientProcessMonitor();
+
             Result RegisterClient(const sf::ClientProcessId &client_process_id);
         };
     
@@ -55,6 +55,12 @@ namespace ams::mitm::ldn {
 
     void ICommunicationService::setState(CommState state) {
         current_state = state;
+
+        // Keep scan results warm only while the game is looking for networks
+        if (ryuldn_client) {
+            ryuldn_client->SetBackgroundScan(state == CommState::Station);
+        }
+
         onEventFired();
     }
 
@@ -62,7 +68,20 @@ namespace ams::mitm::ldn {
         if (connected) {
             disconnect_reason = ryuldn::DisconnectReason::None;
             disconnect_ip = 0;
-            network_info = info;
+
+            // Diff the node array against the last sync so GetNetworkInfoLatestUpdate reports joins/leaves
+            const bool joining = current_state == CommState::AccessPoint || current_state == CommState::Station;
+            bool nodes_changed = false;
+            {
+                std::scoped_lock lk(network_info_mutex);
+                if (joining) {
+                    // Fresh network: previous node array and pending updates belong to an old session
+                    std::memset(&network_info, 0, sizeof(network_info));
+                    std::memset(node_latest_updates, 0, sizeof(node_latest_updates));
+                }
+                nodes_changed = DiffNodeUpdates(network_info, info, node_latest_updates);
+                network_info = info;
+            }
 
             if (current_state == CommState::AccessPoint) {
                 LOG_INFO(COMP_LDN_ICOM, "onNetworkChange: AP created, state AccessPoint -> AccessPointCreated");
@@ -70,6 +89,9 @@ namespace ams::mitm::ldn {
             } else if (current_state == CommState::Station) {
                 LOG_INFO(COMP_LDN_ICOM, "onNetworkChange: Station connected, state Station -> StationConnected");
                 setState(CommState::StationConnected);
+            } else if (nodes_changed) {
+                // SyncNetwork with joins/leaves: wake the game like real ldn does
+                onEventFired();
             }
             return;
         }
@@ -89,7 +111,10 @@ namespace ams::mitm::ldn {
 
         disconnect_reason = effective_reason;
         disconnect_ip = ryuldn_client ? ryuldn_client->GetDisconnectIp() : 0;
-        network_info = info;
+        {
+            std::scoped_lock lk(network_info_mutex);
+            network_info = info;
+        }
 
         if (current_state == CommState::AccessPointCreated) {
             LOG_INFO(COMP_LDN_ICOM, "onNetworkChange: AP disconnected, state AccessPointCreated -> AccessPoint");
@@ -110,6 +135,12 @@ namespace ams::mitm::ldn {
     Result ICommunicationService::Initialize(const sf::ClientProcessId &client_process_id) {
         LOG_INFO_ARGS(COMP_LDN_ICOM, "ICommunicationService::Initialize pid: %" PRIu64, client_process_id.GetValue());
 
+        // Let this process' bsd:u sessions be mitm'd for the virtual network
+        if (this->client_process_id == 0) {
+            this->client_process_id = client_process_id.GetValue().value;
+            BsdMitmService::RegisterLdnClient(this->client_process_id);
+        }
+
         if (this->state_event == nullptr) {
             // ClearMode, inter_process
             LOG_INFO(COMP_LDN_ICOM, "StateEvent is null");
@@ -170,7 +201,11 @@ namespace ams::mitm::ldn {
                         return;
                     }
                     LOG_HEAP(COMP_LDN_ICOM, "after LdnProxy");
+                    this->ryuldn_proxy->SetSlowConsumerWindow(LdnConfig::GetSlowConsumerMs());
                     BsdMitmService::RegisterProxy(this->ryuldn_proxy);
+                    LdnConfig::SetSocketStatsHandler([proxy = this->ryuldn_proxy](RyuLdnSocketStats* out, size_t count) {
+                        return proxy->GetSocketStats(out, count);
+                    });
                     LOG_INFO(COMP_LDN_ICOM, "RyuLDN proxy created and registered");
                 }
             });
@@ -178,6 +213,8 @@ namespace ams::mitm::ldn {
             // Note: Proxy data callback is now handled by LdnProxy via protocol registration
             // No need to manually forward anymore
 
+            this->ryuldn_client->SetScanCacheWindow(LdnConfig::GetScanCacheMs());
+
             Result rc = this->ryuldn_client->Initialize();
             if (R_FAILED(rc)) {
                 LOG_INFO_ARGS(COMP_LDN_ICOM, "Failed to initialize RyuLDN client: 0x%x", rc);
@@ -216,6 +253,7 @@ namespace ams::mitm::ldn {
         // Destroy proxy first
         if (this->ryuldn_proxy) {
             BsdMitmService::UnregisterProxy();
+            LdnConfig::SetSocketStatsHandler(nullptr);
             delete this->ryuldn_proxy;
             this->ryuldn_proxy = nullptr;
         }
@@ -235,6 +273,11 @@ namespace ams::mitm::ldn {
             this->state_event = nullptr;
         }
 
+        if (this->client_process_id != 0) {
+            BsdMitmService::UnregisterLdnClient(this->client_process_id);
+            this->client_process_id = 0;
+        }
+
         setState(CommState::None);
 
         return ResultSuccess();
@@ -453,6 +496,7 @@ namespace ams::mitm::ldn {
 
     Result ICommunicationService::GetNetworkInfo(sf::Out<NetworkInfo> info) {
         LOG_INFO_ARGS(COMP_LDN_ICOM, "GetNetworkInfo: state=%d (0x%x)", static_cast<u32>(current_state), static_cast<u32>(current_state));
+        std::scoped_lock lk(network_info_mutex);
         info.SetValue(network_info);
         return ResultSuccess();
     }
@@ -494,6 +538,7 @@ namespace ams::mitm::ldn {
             return MAKERESULT(0xCB, 32);
         }
 
+        std::scoped_lock lk(network_info_mutex);
         buffer.SetValue(network_info);
 
         size_t count = std::min(pUpdates.GetSize(), static_cast<size_t>(NodeCountMax));
@@ -36,6 +36,8 @@ namespace ams::mitm::ldn {
             ryuldn::DisconnectReason disconnect_reason;
             u32 disconnect_ip;
             NodeLatestUpdate node_latest_updates[NodeCountMax];
+            os::Mutex network_info_mutex;  // network_info + node_latest_updates (worker thread vs IPC)
+            u64 client_process_id;         // Registered with BsdMitmService while initialized, 0 = none
 
             void setState(CommState state);
             void onNetworkChange(const NetworkInfo& info, bool connected, ryuldn::DisconnectReason reason);
@@ -47,7 +49,9 @@ namespace ams::mitm::ldn {
                 ryuldn_proxy(nullptr),
                 current_state(CommState::None),
                 disconnect_reason(ryuldn::DisconnectReason::None),
-                disconnect_ip(0)
+                disconnect_ip(0),
+                network_info_mutex(false),
+                client_process_id(0)
             {
                 LOG_INFO(COMP_LDN_ICOM, "ICommunicationService");  // ✅ Corrigé
                 std::memset(&network_info, 0, sizeof(network_info));
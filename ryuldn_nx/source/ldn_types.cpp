@@ -14,6 +14,31 @@ namespace ams::mitm::ldn {
         std::memcpy(out->unkRandom, info->ldn.unkRandom, 16);
     }
 
+    bool DiffNodeUpdates(const NetworkInfo& previous, const NetworkInfo& current, NodeLatestUpdate* updates) {
+        bool changed = false;
+        for (size_t i = 0; i < NodeCountMax; i++) {
+            const NodeInfo& before = previous.ldn.nodes[i];
+            const NodeInfo& after = current.ldn.nodes[i];
+
+            u8 change = NodeStateChange_None;
+            if (before.isConnected && !after.isConnected) {
+                change = NodeStateChange_Disconnect;
+            } else if (!before.isConnected && after.isConnected) {
+                change = NodeStateChange_Connect;
+            } else if (before.isConnected && after.isConnected &&
+                       (before.ipv4Address != after.ipv4Address || !(before.macAddress == after.macAddress))) {
+                // Slot reused by another station between two syncs
+                change = NodeStateChange_DisconnectAndConnect;
+            }
+
+            if (change != NodeStateChange_None) {
+                updates[i].stateChange |= change;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
     bool MacAddress::operator==(const MacAddress& b) const {
         return std::memcmp(this->raw, b.raw, sizeof(MacAddress)) == 0;
     }
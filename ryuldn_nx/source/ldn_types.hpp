@@ -172,4 +172,8 @@ namespace ams::mitm::ldn {
 
     void NetworkInfo2NetworkConfig(NetworkInfo* info, NetworkConfig* out);
     void NetworkInfo2SecurityParameter(NetworkInfo* info, SecurityParameter* out);
+
+    // Accumulate per-node Connect/Disconnect flags between two node arrays into updates[NodeCountMax]
+    // Flags are OR-ed until the game reads them; returns true if any node changed
+    bool DiffNodeUpdates(const NetworkInfo& previous, const NetworkInfo& current, NodeLatestUpdate* updates);
 }
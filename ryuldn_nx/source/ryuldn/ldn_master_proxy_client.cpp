@@ -18,7 +18,8 @@ LdnMasterProxyClient::LdnMasterProxyClient(const char* serverAddress, int server
       _serverPort(serverPort), 
       _useP2pProxy(useP2pProxy),
       _workerThread{},  // Zero-initialize thread structure
-      _protocol(g_sharedBufferPool)  // Use shared BufferPool
+      _protocol(g_sharedBufferPool),  // Use shared BufferPool
+      _scanMutex(false)
 {
 
     _socket = -1;
@@ -30,6 +31,16 @@ LdnMasterProxyClient::LdnMasterProxyClient(const char* serverAddress, int server
     _disconnectReason = DisconnectReason::None;
     _disconnectIp = 0;
     _lastError = NetworkError::None;
+    std::memset(&_scanFilter, 0, sizeof(_scanFilter));
+    _hasScanFilter = false;
+    _scanInFlight = false;
+    _backgroundScan = false;
+    _scanCacheMs = 0;
+    _lastForegroundScan = 0;
+    _scanRefreshTimer = TimerQueue::InvalidTimerId;
+    for (auto& entry : _scanCache) {
+        entry.timestamp = 0;
+    }
 
     // Allocate thread stack only
     _threadStack.reset(new (std::nothrow) u8[ThreadStackSize + os::ThreadStackAlignment]);
@@ -75,20 +86,32 @@ LdnMasterProxyClient::~LdnMasterProxyClient() {
     // No manual cleanup needed for events
 
     if (_hostedProxy) delete _hostedProxy;
-    if (_connectedProxy) delete _connectedProxy;
+    ReleaseConnectedProxy(false);
 }
 
 Result LdnMasterProxyClient::Initialize() {
     if (!_threadStack) return MAKERESULT(0xFD, 1);
     
     // Initialize timeout handler with explicit nothrow allocation
-    _timeout.reset(new (std::nothrow) NetworkTimeout(InactiveTimeout, [this]() {
+    _timeout.reset(new (std::nothrow) NetworkTimeout(&_timers, InactiveTimeout, [this]() {
         this->TimeoutConnection();
     }));
     
-    if (!_timeout) {
+    if (!_timeout || !_timeout->IsValid()) {
         AMS_ABORT("LdnMasterProxyClient: Failed to allocate NetworkTimeout");
     }
+
+    // Background scan refresh runs on the worker thread
+    _scanRefreshTimer = _timers.Register([this]() {
+        this->RefreshScanCache();
+    });
+
+    // Lets Finalize() and newly armed deadlines interrupt the worker's poll()
+    if (_wakeSocket.Open()) {
+        _timers.AttachWakeSocket(&_wakeSocket);
+    } else {
+        LOG_WARN_ARGS(COMP_RLDN_MASTER,"Initialize: Failed to open wake socket (errno=%d), falling back to %dms poll", errno, MaxPollIntervalMs);
+    }
     
     uintptr_t stackAddr = reinterpret_cast<uintptr_t>(_threadStack.get());
     uintptr_t alignedAddr = util::AlignUp(stackAddr, os::ThreadStackAlignment);
@@ -118,7 +141,15 @@ Result LdnMasterProxyClient::Initialize() {
 
 Result LdnMasterProxyClient::Finalize() {
     if (_stop) return ResultSuccess();
+    const os::Tick start = os::GetSystemTick();
     _stop = true;
+
+    // Signal first, then join: the worker leaves poll()/its deadline wait immediately
+    _timers.Wake();
+    os::WaitThread(&_workerThread);
+    os::DestroyThread(&_workerThread);
+    std::memset(&_workerThread, 0, sizeof(_workerThread));
+
     if (_socket >= 0) Disconnect();
     
     // Cleanup timeout
@@ -126,10 +157,13 @@ Result LdnMasterProxyClient::Finalize() {
         _timeout->Dispose();
         _timeout.reset();
     }
-    
-    os::WaitThread(&_workerThread);
-    os::DestroyThread(&_workerThread);
-    std::memset(&_workerThread, 0, sizeof(_workerThread));
+    _timers.Unregister(_scanRefreshTimer);
+    _scanRefreshTimer = TimerQueue::InvalidTimerId;
+
+    _timers.AttachWakeSocket(nullptr);
+    _wakeSocket.Close();
+
+    LOG_INFO_ARGS(COMP_RLDN_MASTER,"Finalize: Teardown took %ldms", (os::GetSystemTick() - start).ToTimeSpan().GetMilliSeconds());
     return ResultSuccess();
 }
 
@@ -140,12 +174,26 @@ void LdnMasterProxyClient::WorkerThreadFunc(void* arg) {
 
 void LdnMasterProxyClient::WorkerLoop() {
     while (!_stop) {
+        // Sleep until data arrives, the nearest deadline expires or we are woken, no fixed wakeup period
+        s64 nextDeadline = _timers.GetNextTimeoutMs();
+
         if (_connected && _socket >= 0) {
-            // Use poll() to wait for data with 100ms timeout instead of busy-waiting
-            struct pollfd pfd = {_socket, POLLIN, 0};
-            int pollRet = ::poll(&pfd, 1, 100);
+            int pollTimeout = static_cast<int>(nextDeadline);
+            if (!_wakeSocket.IsOpen() && (nextDeadline < 0 || nextDeadline > MaxPollIntervalMs)) {
+                pollTimeout = MaxPollIntervalMs;
+            }
+
+            struct pollfd pfds[2] = {
+                {_socket, POLLIN, 0},
+                {_wakeSocket.GetFd(), POLLIN, 0},
+            };
+            int pollRet = ::poll(pfds, _wakeSocket.IsOpen() ? 2 : 1, pollTimeout);
             
-            if (pollRet > 0 && (pfd.revents & POLLIN)) {
+            if (pollRet > 0 && (pfds[1].revents & POLLIN)) {
+                _wakeSocket.Drain();
+            }
+
+            if (pollRet > 0 && (pfds[0].revents & POLLIN) && !_stop) {
                 // Data is available, receive it
                 if (ReceiveData() < 0) {
                     Disconnect();
@@ -160,16 +208,17 @@ void LdnMasterProxyClient::WorkerLoop() {
                     _events.errorEvent.Signal();
                 }
             }
-            // pollRet == 0 means timeout, just continue to next iteration
+            // pollRet == 0 means a deadline is due, handled below
         } else {
-            // Not connected, just sleep a bit
-            os::SleepThread(TimeSpan::FromMilliSeconds(100));
+            // Not connected: block until a deadline expires or EnsureConnected()/Finalize() wakes us
+            _timers.WaitForNextDeadline();
         }
         
-        // Check for timeouts periodically
-        if (_timeout) {
-            _timeout->CheckTimeout();
-        }
+        // Fire expired timeouts (inactivity, ...)
+        _timers.RunExpired();
+
+        // A failed P2P join leaves an idle client behind; its thread has exited, so freeing it does not block
+        ReleaseConnectedProxy(true);
     }
 }
 
@@ -247,6 +296,9 @@ bool LdnMasterProxyClient::EnsureConnected() {
     _protocol.Reset();
     _events.connectedEvent.Signal();
 
+    // Move WorkerLoop from its idle wait to polling the new socket
+    _timers.Wake();
+
     // Give the server a moment to be ready
     os::SleepThread(TimeSpan::FromMilliSeconds(100));
 
@@ -321,6 +373,7 @@ bool LdnMasterProxyClient::EnsureConnected() {
 void LdnMasterProxyClient::Disconnect() {
     if (_socket >= 0) { close(_socket); _socket = -1; }
     _connected = false;
+    InvalidateScanCache();
     DisconnectInternal();
 }
 
@@ -328,7 +381,7 @@ void LdnMasterProxyClient::DisconnectInternal() {
     if (_networkConnected) {
         _networkConnected = false;
         if (_hostedProxy) { delete _hostedProxy; _hostedProxy = nullptr; }
-        if (_connectedProxy) { delete _connectedProxy; _connectedProxy = nullptr; }
+        ReleaseConnectedProxy(false);
 
         if (_networkChangeCallback) {
             NetworkInfo info{};
@@ -346,7 +399,7 @@ int LdnMasterProxyClient::SendPacket(const u8* data, int size) {
     LOG_DBG_ARGS(COMP_RLDN_MASTER," SendPacket: Sending %d bytes", size);
     
     // Hex dump header + up to 64 bytes (always logs the header bytes even if packet is larger)
-    {
+    if (ams::log::gLogLevel.load(std::memory_order_relaxed) >= 4) {
         int dump_len = std::min(size, 64);
         char hexdump[512] = {0};
         int hexpos = 0;
@@ -364,6 +417,10 @@ int LdnMasterProxyClient::SendPacket(const u8* data, int size) {
         return -1;
     }
     
+    return SendAllLocked(data, size);
+}
+
+int LdnMasterProxyClient::SendAllLocked(const u8* data, int size) {
     // Send entire buffer in one call to avoid fragmentation
     // TCP_NODELAY is already enabled, so this will be sent immediately
     int sent = 0;
@@ -391,6 +448,34 @@ int LdnMasterProxyClient::SendPacket(const u8* data, int size) {
 
 int LdnMasterProxyClient::SendRawPacket(const u8* data, int size) { return SendPacket(data, size); }
 
+int LdnMasterProxyClient::SendRawPacket(const u8* head, int headSize, const u8* body, int bodySize) {
+    // bsd has no sendmsg/writev, so the gather is done here: small frames are joined on the stack
+    // and sent at once; larger ones go out as two sends under one lock so frames never interleave
+    constexpr int StackFrameSize = 2048;
+
+    std::lock_guard<std::mutex> lock(_sendMutex);
+
+    if (!_connected || _socket < 0) {
+        LOG_ERR_ARGS(COMP_RLDN_MASTER,"SendRawPacket: Not connected (_connected=%d, _socket=%d)", _connected, _socket);
+        return -1;
+    }
+
+    if (headSize + bodySize <= StackFrameSize) {
+        u8 frame[StackFrameSize];
+        std::memcpy(frame, head, headSize);
+        std::memcpy(frame + headSize, body, bodySize);
+        return SendAllLocked(frame, headSize + bodySize);
+    }
+
+    if (SendAllLocked(head, headSize) < 0) {
+        return -1;
+    }
+    if (SendAllLocked(body, bodySize) < 0) {
+        return -1;
+    }
+    return headSize + bodySize;
+}
+
 int LdnMasterProxyClient::ReceiveData() {
     // Protect socket read to prevent multiple concurrent recv() calls
     std::lock_guard<std::mutex> lock(_receiveMutex);
@@ -485,8 +570,35 @@ void LdnMasterProxyClient::HandleDisconnected(const LdnHeader&, const Disconnect
     DisconnectInternal(); 
 }
 void LdnMasterProxyClient::HandleRejectReply(const LdnHeader&) { _events.rejectEvent.Signal(); }
-void LdnMasterProxyClient::HandleScanReply(const LdnHeader&, const NetworkInfo& i) { _availableGames.push_back(i); }
-void LdnMasterProxyClient::HandleScanReplyEnd(const LdnHeader&) { _events.scanEvent.Signal(); }
+void LdnMasterProxyClient::HandleScanReply(const LdnHeader&, const NetworkInfo& i) {
+    std::scoped_lock lk(_scanMutex);
+    _availableGames.push_back(i);
+}
+void LdnMasterProxyClient::HandleScanReplyEnd(const LdnHeader&) {
+    {
+        std::scoped_lock lk(_scanMutex);
+        if (_scanInFlight && _scanCacheMs > 0) {
+            ScanCacheEntry* entry = FindScanCache(_scanFilter);
+            if (!entry) {
+                // Replace the oldest entry
+                entry = &_scanCache[0];
+                for (auto& candidate : _scanCache) {
+                    if (candidate.timestamp < entry->timestamp) entry = &candidate;
+                }
+                entry->filter = _scanFilter;
+            }
+            entry->results = _availableGames;
+            entry->timestamp = os::ConvertToTimeSpan(os::GetSystemTick()).GetMilliSeconds();
+
+            // Keep the cache warm while the game sits on its lobby screen
+            if (_backgroundScan) {
+                _timers.Arm(_scanRefreshTimer, _scanCacheMs);
+            }
+        }
+        _scanInFlight = false;
+    }
+    _events.scanEvent.Signal();
+}
 void LdnMasterProxyClient::HandleProxyConfig(const LdnHeader& h, const ProxyConfig& c) { 
     _config = c; if (_proxyConfigCallback) _proxyConfigCallback(h, c); 
 }
@@ -514,8 +626,18 @@ void LdnMasterProxyClient::HandleExternalProxy(const LdnHeader&, const ExternalP
     } else return;
     proxy::P2pProxyClient* client = new (std::nothrow) proxy::P2pProxyClient(ipStr, config.proxyPort);
     if (!client) return;
-    _connectedProxy = client;
-    if (!client->Connect() || !client->PerformAuth(config)) { delete client; _connectedProxy = nullptr; }
+    ReleaseConnectedProxy(false);
+    {
+        std::lock_guard<std::mutex> lock(_connectedProxyMutex);
+        _connectedProxy = client;
+    }
+
+    // Connect + auth run on the P2P client's thread so WorkerLoop keeps answering pings and SyncNetwork.
+    // On failure (bounded by FailureTimeout) the client idles and traffic stays on the server relay.
+    if (!client->ConnectAsync(config)) {
+        LOG_WARN_ARGS(COMP_RLDN_MASTER,"HandleExternalProxy: Could not start P2P join to %s:%u, using server relay", ipStr, config.proxyPort);
+        ReleaseConnectedProxy(false);
+    }
 }
 
 void LdnMasterProxyClient::HandleSetAdvertiseData(const LdnHeader&, const u8* data, u32 size) {
@@ -696,59 +818,167 @@ Result LdnMasterProxyClient::Scan(NetworkInfo* nets, u16* count, const ScanFilte
         _timeout->RefreshTimeout();
     }
 
-    // Clear previous results
-    _availableGames.clear();
-    
+    const u16 capacity = *count;
+    auto copyResults = [&](const std::vector<NetworkInfo>& results) {
+        u16 found = std::min(static_cast<u16>(results.size()), capacity);
+        for (u16 i = 0; i < found; i++) nets[i] = results[i];
+        *count = found;
+    };
+
+    // Serve from cache when a scan with the same filter completed within the freshness window
+    bool joinInFlight = false;
+    bool otherInFlight = false;
+    {
+        std::scoped_lock lk(_scanMutex);
+        const u64 now = os::ConvertToTimeSpan(os::GetSystemTick()).GetMilliSeconds();
+        _lastForegroundScan = now;
+
+        ScanCacheEntry* entry = FindScanCache(f);
+        if (entry && now - entry->timestamp < _scanCacheMs) {
+            copyResults(entry->results);
+            LOG_INFO_ARGS(COMP_RLDN_MASTER,"Scan: Served %u networks from cache (age %lums)", *count, now - entry->timestamp);
+            return ResultSuccess();
+        }
+
+        joinInFlight = _scanInFlight && std::memcmp(&_scanFilter, &f, sizeof(f)) == 0;
+        otherInFlight = _scanInFlight && !joinInFlight;
+    }
+
     if (!EnsureConnected()) { 
         LOG_ERR(COMP_RLDN_MASTER,"Scan: Failed to ensure connection to master server");
         *count = 0;
         return MAKERESULT(0xFD, 1); 
     }
-    
-    LOG_DBG(COMP_RLDN_MASTER," Scan: Connected, sending scan request");
-    // Reset scan event and send scan request
-    _events.scanEvent.Clear();
-    {
-        ScopedBuffer buffer(g_sharedBufferPool);
-        if (!buffer.Get()) {
-            LOG_ERR(COMP_RLDN_MASTER,"Scan: Failed to borrow buffer");
+
+    // Replies are not tagged with their filter: let a background scan for another filter finish first
+    if (otherInFlight) {
+        LOG_DBG(COMP_RLDN_MASTER," Scan: Waiting for in-flight scan with another filter");
+        _events.scanEvent.TimedWait(TimeSpan::FromMilliSeconds(ScanTimeout));
+    }
+
+    if (joinInFlight) {
+        LOG_DBG(COMP_RLDN_MASTER," Scan: Joining in-flight background scan");
+    } else {
+        LOG_DBG(COMP_RLDN_MASTER," Scan: Connected, sending scan request");
+        {
+            std::scoped_lock lk(_scanMutex);
+            _availableGames.clear();
+            _scanFilter = f;
+            _hasScanFilter = true;
+            _scanInFlight = true;
+            _events.scanEvent.Clear();
+        }
+        if (!SendScanRequest(f)) {
+            std::scoped_lock lk(_scanMutex);
+            _scanInFlight = false;
             *count = 0;
             return MAKERESULT(0xFD, 1);
         }
-        int sz = RyuLdnProtocol::Encode(PacketId::Scan, f, buffer.Get());
-        LOG_DBG_ARGS(COMP_RLDN_MASTER," Scan: Encoded packet size=%d", sz);
-        LOG_DBG_ARGS(COMP_RLDN_MASTER," Scan: ScanFilter size=%zu bytes", sizeof(ScanFilter));
-        
-        // Log first bytes of encoded packet
-        if (sz > 0) {
-            char hexdump[256] = {0};
-            int hexpos = 0;
-            int dumpSize = (sz < 80) ? sz : 80;
-            for (int i = 0; i < dumpSize && hexpos < 250; i++) {
-                hexpos += snprintf(hexdump + hexpos, sizeof(hexdump) - hexpos, "%02X ", buffer.Get()[i]);
-            }
-            LOG_DBG_ARGS(COMP_RLDN_MASTER," Scan: Encoded packet hex (first %d bytes): %s", dumpSize, hexdump);
-        }
-        
-        SendPacket(buffer.Get(), sz);
     }
     
     LOG_DBG_ARGS(COMP_RLDN_MASTER," Scan: Waiting for scan results (timeout=%ums)", ScanTimeout);
-    // Wait for scan completion (ScanReplyEnd) with timeout
-    if (!_events.scanEvent.TimedWait(TimeSpan::FromMilliSeconds(ScanTimeout))) { 
-        LOG_WARN_ARGS(COMP_RLDN_MASTER,"Scan: Timeout waiting for scan results after %ums", ScanTimeout);
-        *count = 0;
-        return ResultSuccess();  // Timeout is not an error
+    // Returns as soon as ScanReplyEnd arrives
+    const bool completed = _events.scanEvent.TimedWait(TimeSpan::FromMilliSeconds(ScanTimeout));
+
+    std::scoped_lock lk(_scanMutex);
+    if (!completed) {
+        // Timeout is not an error: return whatever replies arrived
+        _scanInFlight = false;
+        copyResults(_availableGames);
+        LOG_WARN_ARGS(COMP_RLDN_MASTER,"Scan: Timeout waiting for scan results after %ums, returning %u partial results", ScanTimeout, *count);
+        return ResultSuccess();
     }
-    
-    // Copy results
-    u16 found = std::min(static_cast<u16>(_availableGames.size()), *count);
-    for (u16 i = 0; i < found; i++) nets[i] = _availableGames[i];
-    *count = found;
-    LOG_INFO_ARGS(COMP_RLDN_MASTER,"Scan: Completed, found %u networks", found);
+
+    ScanCacheEntry* entry = FindScanCache(f);
+    copyResults(entry ? entry->results : _availableGames);
+    LOG_INFO_ARGS(COMP_RLDN_MASTER,"Scan: Completed, found %u networks", *count);
     return ResultSuccess();
 }
 
+bool LdnMasterProxyClient::SendScanRequest(const ScanFilter& f) {
+    ScopedBuffer buffer(g_sharedBufferPool);
+    if (!buffer.Get()) {
+        LOG_ERR(COMP_RLDN_MASTER,"Scan: Failed to borrow buffer");
+        return false;
+    }
+    int sz = RyuLdnProtocol::Encode(PacketId::Scan, f, buffer.Get());
+    LOG_DBG_ARGS(COMP_RLDN_MASTER," Scan: Encoded packet size=%d", sz);
+    LOG_DBG_ARGS(COMP_RLDN_MASTER," Scan: ScanFilter size=%zu bytes", sizeof(ScanFilter));
+    
+    // Log first bytes of encoded packet
+    if (sz > 0) {
+        char hexdump[256] = {0};
+        int hexpos = 0;
+        int dumpSize = (sz < 80) ? sz : 80;
+        for (int i = 0; i < dumpSize && hexpos < 250; i++) {
+            hexpos += snprintf(hexdump + hexpos, sizeof(hexdump) - hexpos, "%02X ", buffer.Get()[i]);
+        }
+        LOG_DBG_ARGS(COMP_RLDN_MASTER," Scan: Encoded packet hex (first %d bytes): %s", dumpSize, hexdump);
+    }
+    
+    return SendPacket(buffer.Get(), sz) == sz;
+}
+
+void LdnMasterProxyClient::RefreshScanCache() {
+    ScanFilter filter;
+    {
+        std::scoped_lock lk(_scanMutex);
+        if (!_backgroundScan || _scanCacheMs == 0 || _scanInFlight || !_hasScanFilter) return;
+        if (!_connected || _networkConnected) return;
+
+        const u64 now = os::ConvertToTimeSpan(os::GetSystemTick()).GetMilliSeconds();
+        if (now - _lastForegroundScan > ScanRefreshIdleLimit) {
+            LOG_DBG(COMP_RLDN_MASTER," RefreshScanCache: Game stopped scanning, pausing background refresh");
+            return;
+        }
+
+        filter = _scanFilter;
+        _availableGames.clear();
+        _scanInFlight = true;
+        _events.scanEvent.Clear();
+    }
+
+    LOG_DBG(COMP_RLDN_MASTER," RefreshScanCache: Sending background scan");
+    if (!SendScanRequest(filter)) {
+        std::scoped_lock lk(_scanMutex);
+        _scanInFlight = false;
+    }
+}
+
+void LdnMasterProxyClient::InvalidateScanCache() {
+    std::scoped_lock lk(_scanMutex);
+    for (auto& entry : _scanCache) {
+        entry.timestamp = 0;
+        entry.results.clear();
+    }
+    _scanInFlight = false;
+}
+
+// Caller must hold _scanMutex
+LdnMasterProxyClient::ScanCacheEntry* LdnMasterProxyClient::FindScanCache(const ScanFilter& f) {
+    for (auto& entry : _scanCache) {
+        if (entry.timestamp != 0 && std::memcmp(&entry.filter, &f, sizeof(f)) == 0) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+void LdnMasterProxyClient::SetScanCacheWindow(u32 ms) {
+    std::scoped_lock lk(_scanMutex);
+    _scanCacheMs = ms;
+    LOG_INFO_ARGS(COMP_RLDN_MASTER,"SetScanCacheWindow: %ums%s", ms, ms == 0 ? " (disabled)" : "");
+}
+
+void LdnMasterProxyClient::SetBackgroundScan(bool enabled) {
+    std::scoped_lock lk(_scanMutex);
+    if (_backgroundScan == enabled) return;
+    _backgroundScan = enabled;
+    if (!enabled) {
+        _timers.Disarm(_scanRefreshTimer);
+    }
+}
+
 Result LdnMasterProxyClient::DisconnectNetwork() {
     if (_networkConnected) {
         _disconnectReason = DisconnectReason::DisconnectedByUser;
@@ -896,10 +1126,21 @@ void LdnMasterProxyClient::DisconnectProxy() {
         _hostedProxy = nullptr;
     }
     
-    if (_connectedProxy) {
-        delete _connectedProxy;
+    ReleaseConnectedProxy(false);
+}
+
+void LdnMasterProxyClient::ReleaseConnectedProxy(bool onlyIfFailed) {
+    proxy::P2pProxyClient* client = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(_connectedProxyMutex);
+        if (!_connectedProxy || (onlyIfFailed && !_connectedProxy->HasFailed())) return;
+        client = _connectedProxy;
         _connectedProxy = nullptr;
     }
+
+    // Deleted outside the lock: a client still joining is woken by Disconnect, but joining its thread takes a moment
+    if (onlyIfFailed) LOG_INFO(COMP_RLDN_MASTER,"WorkerLoop: Releasing failed P2P client, traffic stays on the server relay");
+    delete client;
 }
 
 } // namespace ams::mitm::ldn::ryuldn
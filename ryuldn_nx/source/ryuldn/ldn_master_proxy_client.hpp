@@ -3,6 +3,7 @@
 #include "ryu_ldn_protocol.hpp"
 #include "buffer_pool.hpp"
 #include "network_timeout.hpp"
+#include "wake_socket.hpp"
 #include "types.hpp"
 #include "system_event_pool.hpp"
 #include "proxy/p2p_proxy_server.hpp"
@@ -52,9 +53,36 @@ namespace ams::mitm::ldn::ryuldn {
 
         // Use protocol with shared BufferPool
         RyuLdnProtocol _protocol;
+
+        // Deadlines driven by WorkerLoop (must outlive _timeout)
+        TimerQueue _timers;
         std::unique_ptr<NetworkTimeout> _timeout;
 
-        std::vector<NetworkInfo> _availableGames;
+        // Wakes WorkerLoop out of poll() (new deadline, Finalize)
+        WakeSocket _wakeSocket;
+
+        // Upper bound on a connected poll() if the wake socket could not be opened
+        static constexpr int MaxPollIntervalMs = 1000;
+
+        std::vector<NetworkInfo> _availableGames;  // Replies of the in-flight scan
+
+        // Scan result cache keyed on ScanFilter, filled on ScanReplyEnd
+        struct ScanCacheEntry {
+            ScanFilter filter;
+            std::vector<NetworkInfo> results;
+            u64 timestamp;  // ms, 0 = empty
+        };
+        static constexpr size_t ScanCacheEntries = 2;
+        static constexpr u64 ScanRefreshIdleLimit = 5000;  // Stop background refresh 5s after the game's last Scan()
+        ScanCacheEntry _scanCache[ScanCacheEntries];
+        os::Mutex _scanMutex;
+        ScanFilter _scanFilter;       // Filter of the in-flight (or last) scan
+        bool _hasScanFilter;
+        bool _scanInFlight;
+        bool _backgroundScan;         // Game is in Station state
+        u32 _scanCacheMs;             // Freshness window, 0 = cache disabled
+        u64 _lastForegroundScan;
+        TimerQueue::TimerId _scanRefreshTimer;
         DisconnectReason _disconnectReason;
         u32 _disconnectIp;
         NetworkError _lastError;
@@ -69,6 +97,7 @@ namespace ams::mitm::ldn::ryuldn {
         // Proxies rétablis en pointeurs bruts (non RAII)
         proxy::P2pProxyServer* _hostedProxy;
         proxy::P2pProxyClient* _connectedProxy;
+        std::mutex _connectedProxyMutex;  // _connectedProxy is swapped by the worker and the IPC thread
 
         std::mutex _sendMutex;
 
@@ -89,11 +118,13 @@ namespace ams::mitm::ldn::ryuldn {
         void TimeoutConnection();
 
         int SendPacket(const u8* data, int size);
+        int SendAllLocked(const u8* data, int size);   // Caller holds _sendMutex
         int ReceiveData();
 
         void UpdatePassphraseIfNeeded(const char* passphrase);
         void ConfigureAccessPoint(RyuNetworkConfig& config);
         void DisconnectProxy();
+        void ReleaseConnectedProxy(bool onlyIfFailed);
 
         // Protocol event handlers
         void HandleInitialize(const LdnHeader& header, const InitializeMessage& msg);
@@ -119,6 +150,12 @@ namespace ams::mitm::ldn::ryuldn {
 
         NetworkError ConsumeNetworkError();
 
+        // Scan helpers
+        bool SendScanRequest(const ScanFilter& filter);
+        void RefreshScanCache();
+        void InvalidateScanCache();
+        ScanCacheEntry* FindScanCache(const ScanFilter& filter);
+
     public:
         LdnMasterProxyClient(const char* serverAddress, int serverPort, bool useP2pProxy = true);
         ~LdnMasterProxyClient();
@@ -144,6 +181,8 @@ namespace ams::mitm::ldn::ryuldn {
 
         Result DisconnectNetwork();
         Result Scan(NetworkInfo* networks, u16* count, const ScanFilter& filter);
+        void SetScanCacheWindow(u32 ms);
+        void SetBackgroundScan(bool enabled);
 
         Result SetAdvertiseData(const u8* data, u16 size);
         Result SetStationAcceptPolicy(u8 acceptPolicy);
@@ -151,6 +190,8 @@ namespace ams::mitm::ldn::ryuldn {
 
         // Raw packet sending (Déplacé en PUBLIC pour correspondre à la V1)
         int SendRawPacket(const u8* data, int size);
+        // Same, for a frame split into encoded headers and a payload still in the caller's buffer
+        int SendRawPacket(const u8* head, int headSize, const u8* body, int bodySize);
 
         // Getters
         bool IsConnected() const { return _connected; }
@@ -159,6 +200,8 @@ namespace ams::mitm::ldn::ryuldn {
         DisconnectReason GetDisconnectReason() const { return _disconnectReason; }
         u32 GetDisconnectIp() const { return _disconnectIp; }
         RyuLdnProtocol* GetProtocol() { return &_protocol; }
+        // Deadlines fired on the worker thread (shared with LdnProxy)
+        TimerQueue& GetTimers() { return _timers; }
     };
 
 } // namespace ams::mitm::ldn::ryuldn
@@ -2,8 +2,8 @@
 
 #include <stratosphere.hpp>
 #include <functional>
-#include <atomic>
 #include <memory>
+#include "timer_queue.hpp"
 
 namespace ams::mitm::ldn::ryuldn {
 
@@ -14,62 +14,51 @@ namespace ams::mitm::ldn::ryuldn {
     constexpr int ScanTimeout = 1000;      // Scan operation timeout
 
     // Network timeout handler
-    // Matches Ryujinx LdnRyu/NetworkTimeout.cs behavior
-    // NOTE: Uses simple timestamp-based checking instead of threads to avoid C++ exception allocation issues on Switch
+    // Matches Ryujinx LdnRyu/NetworkTimeout.cs behavior: one-shot idle timer,
+    // re-armed by RefreshTimeout() and cancelled by DisableTimeout()
+    // NOTE: Backed by the owner's TimerQueue instead of a dedicated thread to avoid C++ exception allocation issues on Switch
     class NetworkTimeout {
     private:
         int _idleTimeout;
-        std::function<void()> _timeoutCallback;
-        std::atomic<u64> _lastRefreshTime;
-        std::atomic<bool> _active;
-        os::Mutex _lock;
+        TimerQueue* _queue;
+        TimerQueue::TimerId _timerId;
 
     public:
-        NetworkTimeout(int idleTimeout, std::function<void()> callback)
-            : _idleTimeout(idleTimeout), 
-              _timeoutCallback(callback),
-              _lastRefreshTime(0),
-              _active(true),
-              _lock(false) {}
+        NetworkTimeout(TimerQueue* queue, int idleTimeout, std::function<void()> callback)
+            : _idleTimeout(idleTimeout),
+              _queue(queue),
+              _timerId(TimerQueue::InvalidTimerId)
+        {
+            if (_queue) {
+                _timerId = _queue->Register(std::move(callback));
+            }
+        }
 
         ~NetworkTimeout() {
-            DisableTimeout();
+            Dispose();
         }
 
+        bool IsValid() const { return _timerId != TimerQueue::InvalidTimerId; }
+
         bool RefreshTimeout() {
-            std::scoped_lock lock(_lock);
-            
-            if (_active) {
-                // Just update the last refresh time - checking is done elsewhere
-                _lastRefreshTime = os::ConvertToTimeSpan(os::GetSystemTick()).GetMilliSeconds();
+            if (!IsValid()) {
+                return false;
             }
+            _queue->Arm(_timerId, static_cast<u64>(_idleTimeout));
             return true;
         }
 
-        // Call this periodically from WorkerLoop to check for timeouts
-        void CheckTimeout() {
-            std::scoped_lock lock(_lock);
-            
-            if (!_active || !_timeoutCallback) {
-                return;
-            }
-
-            u64 now = os::ConvertToTimeSpan(os::GetSystemTick()).GetMilliSeconds();
-            u64 elapsed = now - _lastRefreshTime;
-            
-            if (elapsed >= static_cast<u64>(_idleTimeout)) {
-                _timeoutCallback();
-                _lastRefreshTime = now;  // Reset for next timeout
-            }
-        }
-
         void DisableTimeout() {
-            std::scoped_lock lock(_lock);
-            _active = false;
+            if (IsValid()) {
+                _queue->Disarm(_timerId);
+            }
         }
 
         void Dispose() {
-            DisableTimeout();
+            if (IsValid()) {
+                _queue->Unregister(_timerId);
+                _timerId = TimerQueue::InvalidTimerId;
+            }
         }
     };
 
@@ -1,5 +1,6 @@
 #include "ldn_proxy.hpp"
 #include "ldn_proxy_socket.hpp"
+#include "ldn_proxy_socket_pool.hpp"
 #include "../ldn_master_proxy_client.hpp"
 #include "../ryu_ldn_protocol.hpp"
 #include "../buffer_pool.hpp"
@@ -14,10 +15,16 @@ namespace ams::mitm::ldn::ryuldn::proxy {
     LdnProxy::LdnProxy(const ProxyConfig& config, LdnMasterProxyClient* client, RyuLdnProtocol* protocol)
         : _parent(client),
           _protocol(protocol),
-          _socketsMutex(false),
+          _socketsMutex(true),   // Recursive: a listener registers its accepted socket while being routed to
+          _socketPool(nullptr),
+          _pendingFlushMutex(false),
+          _flushTimer(TimerQueue::InvalidTimerId),
           _subnetMask(config.proxySubnetMask),
           _localIp(config.proxyIp),
-          _broadcast(_localIp | (~_subnetMask))
+          _broadcast(_localIp | (~_subnetMask)),
+          _slowConsumerMs(0),
+          _localDeliveredPackets(0),
+          _localDeliveredBytes(0)
     {
         LOG_HEAP(COMP_RLDN_PROXY,"LdnProxy constructor start");
         
@@ -33,6 +40,13 @@ namespace ams::mitm::ldn::ryuldn::proxy {
 
         RegisterHandlers(protocol);
 
+        _flushTimer = _parent->GetTimers().Register([this]() {
+            this->FlushPending();
+        });
+        if (_flushTimer == TimerQueue::InvalidTimerId) {
+            LOG_WARN(COMP_RLDN_PROXY,"LdnProxy: No timer slot left, stream writes will not be coalesced");
+        }
+
         LOG_INFO_ARGS(COMP_RLDN_PROXY,"LdnProxy created: IP=0x%08x, Mask=0x%08x, Broadcast=0x%08x", _localIp, _subnetMask, _broadcast);
         LOG_HEAP(COMP_RLDN_PROXY,"LdnProxy constructor end");
     }
@@ -59,6 +73,10 @@ namespace ams::mitm::ldn::ryuldn::proxy {
             HandleDisconnect(header, disconnect);
         };
 
+        protocol->onReadComplete = [this]() {
+            FlushInboundBatch();
+        };
+
         _protocol = protocol;
     }
 
@@ -67,6 +85,7 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         protocol->onProxyConnectReply = nullptr;
         protocol->onProxyData = nullptr;
         protocol->onProxyDisconnect = nullptr;
+        protocol->onReadComplete = nullptr;
     }
 
     bool LdnProxy::Supported(s32 domain, [[maybe_unused]] s32 type, s32 protocol) {
@@ -98,30 +117,131 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         LOG_INFO_ARGS(COMP_RLDN_PROXY,"LdnProxy: Socket registered (total: %zu)", _sockets.size());
     }
 
+    std::shared_ptr<LdnProxySocket> LdnProxy::CreateSocket(s32 addressFamily, s32 socketType, s32 protocolType) {
+        if (_socketPool) {
+            return _socketPool->Acquire(addressFamily, socketType, protocolType, this);
+        }
+        return std::shared_ptr<LdnProxySocket>(new (std::nothrow) LdnProxySocket(addressFamily, socketType, protocolType, this));
+    }
+
     void LdnProxy::UnregisterSocket(LdnProxySocket* socket) {
+        {
+            // Also waits out a timer flush that is writing this socket's data
+            std::scoped_lock lk(_pendingFlushMutex);
+            _pendingFlush.erase(std::remove(_pendingFlush.begin(), _pendingFlush.end(), socket), _pendingFlush.end());
+        }
+
         std::scoped_lock lk(_socketsMutex);
         _sockets.remove(socket);
         LOG_INFO_ARGS(COMP_RLDN_PROXY,"LdnProxy: Socket unregistered (total: %zu)", _sockets.size());
     }
 
+    void LdnProxy::ScheduleFlush(LdnProxySocket* socket) {
+        bool arm = false;
+        {
+            std::scoped_lock lk(_pendingFlushMutex);
+            if (std::find(_pendingFlush.begin(), _pendingFlush.end(), socket) != _pendingFlush.end()) {
+                return;
+            }
+            // Only the first pending socket arms the timer, later ones must not push the deadline back
+            arm = _pendingFlush.empty();
+            _pendingFlush.push_back(socket);
+        }
+
+        if (arm) {
+            _parent->GetTimers().Arm(_flushTimer, CoalesceFlushDelayMs);
+        }
+    }
+
+    void LdnProxy::FlushPending() {
+        // Runs on the master client worker thread; _socketsMutex is not held so local delivery can take it
+        std::scoped_lock lk(_pendingFlushMutex);
+        for (auto* socket : _pendingFlush) {
+            socket->FlushCoalesced();
+        }
+        _pendingFlush.clear();
+    }
+
+    bool LdnProxy::IsRoutedTo(LdnProxySocket* socket, const ProxyInfo& info) {
+        // Must match protocol and destination port
+        if (socket->GetProtocolType() != static_cast<s32>(info.protocol)) {
+            return false;
+        }
+
+        // An accepted socket also hears its peer on the listen port: an optimistic connector
+        // writes there until the connect reply gives it the accepted socket's own port
+        const sockaddr_in& endpoint = socket->GetLocalEndPoint();
+        if (ntohs(endpoint.sin_port) != info.destPort && socket->GetAcceptedFromPort() != info.destPort) {
+            return false;
+        }
+
+        // Connected sockets only hear from their peer
+        // We can assume packets routed to us have been sent to our destination
+        // They will either be sent to us, or broadcast packets
+        return socket->IsRoutedFrom(info);
+    }
+
     void LdnProxy::ForRoutedSockets(const ProxyInfo& info, std::function<void(LdnProxySocket*)> action) {
         std::scoped_lock lk(_socketsMutex);
 
         for (auto* socket : _sockets) {
-            // Must match protocol and destination port
-            if (socket->GetProtocolType() != static_cast<s32>(info.protocol)) {
-                continue;
+            if (IsRoutedTo(socket, info)) {
+                action(socket);
             }
+        }
+    }
 
-            const sockaddr_in& endpoint = socket->GetLocalEndPoint();
-            if (ntohs(endpoint.sin_port) != info.destPort) {
-                continue;
+    void LdnProxy::FlushInboundBatch() {
+        if (_inboundBatch.empty()) {
+            return;
+        }
+
+        {
+            // One pass over the socket list for the whole read; each receiver is woken once, after
+            // all of its packets are queued. A frame is copied out of the read buffer the first time a
+            // socket is routed to it, so traffic for ports nobody listens on costs nothing
+            std::scoped_lock lk(_socketsMutex);
+            for (const auto& frame : _inboundBatch) {
+                ProxyDataPacket packet = {};
+                for (auto* socket : _sockets) {
+                    if (!IsRoutedTo(socket, frame.header.info)) {
+                        continue;
+                    }
+                    if (!packet.payload && !ProxyDataPacket::Create(&packet, frame.header, &frame.data, &frame.size, 1)) {
+                        LOG_WARN_ARGS(COMP_RLDN_PROXY,"LdnProxy: Out of memory, dropped %zu bytes of proxy data", frame.size);
+                        break;
+                    }
+                    if (!socket->IncomingData(packet, false)) {
+                        continue;
+                    }
+                    if (std::find(_batchTouched.begin(), _batchTouched.end(), socket) == _batchTouched.end()) {
+                        _batchTouched.push_back(socket);
+                    }
+                }
+            }
+
+            for (auto* socket : _batchTouched) {
+                socket->SignalReceive();
             }
+        }
+
+        LOG_DBG_ARGS(COMP_RLDN_PROXY,"LdnProxy: Routed %zu proxy data frames to %zu sockets", _inboundBatch.size(), _batchTouched.size());
+
+        _inboundBatch.clear();
+        _batchTouched.clear();
+    }
+
+    size_t LdnProxy::GetSocketStats(RyuLdnSocketStats* out, size_t count) {
+        std::scoped_lock lk(_socketsMutex);
 
-            // We can assume packets routed to us have been sent to our destination
-            // They will either be sent to us, or broadcast packets
-            action(socket);
+        size_t filled = 0;
+        for (auto* socket : _sockets) {
+            if (filled == count) {
+                break;
+            }
+            socket->GetStats(&out[filled++]);
         }
+        return filled;
     }
 
     u32 LdnProxy::GetIpV4(const sockaddr_in* endpoint) {
@@ -146,29 +266,59 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         return info;
     }
 
+    bool LdnProxy::DeliverLocally(const ProxyDataHeaderFull& header, const u8* const* segments, const size_t* segmentSizes, size_t segmentCount) {
+        const bool toSelf = header.info.destIpV4 == _localIp;
+        if (!toSelf && !IsBroadcast(header.info.destIpV4)) {
+            return false;
+        }
+
+        // Like a real BSD stack, broadcasts are looped back to local sockets (subject to SO_BROADCAST)
+        // as well as sent out; the server only relays them to the other stations
+        ProxyDataHeaderFull localHeader = header;
+        if (localHeader.info.sourceIpV4 == 0) {
+            localHeader.info.sourceIpV4 = _localIp;   // Sent from a socket bound to INADDR_ANY
+        }
+
+        // The payload is only copied once a socket actually wants it, and then only once for all of them
+        ProxyDataPacket packet = {};
+        ForRoutedSockets(localHeader.info, [&](LdnProxySocket* socket) {
+            if (!packet.payload && !ProxyDataPacket::Create(&packet, localHeader, segments, segmentSizes, segmentCount)) {
+                return;
+            }
+            socket->IncomingData(packet);
+        });
+
+        if (packet.payload) {
+            _localDeliveredPackets.fetch_add(1, std::memory_order_relaxed);
+            _localDeliveredBytes.fetch_add(packet.Size(), std::memory_order_relaxed);
+        }
+
+        return toSelf;
+    }
+
     void LdnProxy::HandleConnectionRequest([[maybe_unused]] const LdnHeader& header, const ProxyConnectRequestFull& request) {
+        // Frames decoded before this one in the same read must reach the sockets first
+        FlushInboundBatch();
         ForRoutedSockets(request.info, [&request](LdnProxySocket* socket) {
             socket->IncomingConnectionRequest(request);
         });
     }
 
     void LdnProxy::HandleConnectionResponse([[maybe_unused]] const LdnHeader& header, const ProxyConnectResponseFull& response) {
+        FlushInboundBatch();
         ForRoutedSockets(response.info, [&response](LdnProxySocket* socket) {
             socket->HandleConnectResponse(response);
         });
     }
 
     void LdnProxy::HandleData([[maybe_unused]] const LdnHeader& header, const ProxyDataHeaderFull& proxyHeader, const u8* data, u32 dataSize) {
-        ProxyDataPacket packet;
-        packet.header = proxyHeader;
-        packet.data.assign(data, data + dataSize);
-
-        ForRoutedSockets(proxyHeader.info, [&packet](LdnProxySocket* socket) {
-            socket->IncomingData(packet);
-        });
+        // The protocol keeps the frame in its buffer until onReadComplete, where the whole read is
+        // routed in FlushInboundBatch
+        _inboundBatch.push_back({proxyHeader, data, dataSize});
     }
 
     void LdnProxy::HandleDisconnect([[maybe_unused]] const LdnHeader& header, const ProxyDisconnectMessageFull& disconnect) {
+        FlushInboundBatch();
         ForRoutedSockets(disconnect.info, [&disconnect](LdnProxySocket* socket) {
             socket->HandleDisconnect(disconnect);
         });
@@ -213,6 +363,27 @@ namespace ams::mitm::ldn::ryuldn::proxy {
                  response.info.destIpV4, response.info.destPort);
     }
 
+    void LdnProxy::RejectConnection(const ProxyConnectRequestFull& request) {
+        ProxyConnectResponseFull response;
+        response.info.sourceIpV4 = 0;
+        response.info.sourcePort = request.info.destPort;
+        response.info.destIpV4 = request.info.sourceIpV4;
+        response.info.destPort = request.info.sourcePort;
+        response.info.protocol = request.info.protocol;
+
+        ScopedBuffer packet(g_sharedBufferPool);
+        if (!packet.Get()) {
+            LOG_ERR(COMP_RLDN_PROXY,"LdnProxy: Failed to borrow buffer for RejectConnection");
+            return;
+        }
+        int packetSize = RyuLdnProtocol::Encode(PacketId::ProxyConnectReply, response, packet.Get());
+
+        _parent->SendRawPacket(packet.Get(), packetSize);
+
+        LOG_INFO_ARGS(COMP_RLDN_PROXY,"LdnProxy: RejectConnection to %08x:%u on port %u",
+                 response.info.destIpV4, response.info.destPort, response.info.sourcePort);
+    }
+
     void LdnProxy::EndConnection(const sockaddr_in* localEp, const sockaddr_in* remoteEp, s32 protocolType) {
         // We must tell the other side that our connection is dropped
         ProxyDisconnectMessageFull message;
@@ -234,22 +405,32 @@ namespace ams::mitm::ldn::ryuldn::proxy {
     }
 
     s32 LdnProxy::SendTo(const u8* buffer, size_t bufferSize, [[maybe_unused]] s32 flags, const sockaddr_in* localEp, const sockaddr_in* remoteEp, s32 protocolType) {
+        return SendTo(MakeInfo(localEp, remoteEp, protocolType), buffer, bufferSize);
+    }
+
+    s32 LdnProxy::SendTo(const ProxyInfo& info, const u8* buffer, size_t bufferSize) {
         // We send exactly as much as the user wants us to, currently instantly
         // TODO: handle over "virtual mtu" (we have a max packet size to worry about anyways)
         // fragment if tcp? throw if udp?
 
         ProxyDataHeaderFull header;
-        header.info = MakeInfo(localEp, remoteEp, protocolType);
+        header.info = info;
         header.dataLength = bufferSize;
 
-        ScopedBuffer packet(g_sharedBufferPool);
-        if (!packet.Get()) {
-            LOG_ERR(COMP_RLDN_PROXY,"LdnProxy: Failed to borrow buffer for SendTo");
-            return -1;
+        if (DeliverLocally(header, &buffer, &bufferSize, 1)) {
+            LOG_DBG_ARGS(COMP_RLDN_PROXY,"LdnProxy: SendTo %zu bytes delivered locally to port %u", bufferSize, header.info.destPort);
+            return bufferSize;
         }
-        int packetSize = RyuLdnProtocol::Encode(PacketId::ProxyData, header, buffer, bufferSize, packet.Get());
 
-        _parent->SendRawPacket(packet.Get(), packetSize);
+        // Only the headers are encoded here; the payload goes out straight from the caller's buffer
+        u8 prefix[RyuLdnProtocol::HeaderSize + sizeof(ProxyDataHeaderFull)];
+        RyuLdnProtocol::EncodeHeader(PacketId::ProxyData, sizeof(header) + bufferSize, prefix);
+        std::memcpy(prefix + RyuLdnProtocol::HeaderSize, &header, sizeof(header));
+
+        if (_parent->SendRawPacket(prefix, sizeof(prefix), buffer, static_cast<int>(bufferSize)) < 0) {
+            LOG_WARN(COMP_RLDN_PROXY,"LdnProxy: SendTo failed, master connection unavailable");
+            return -1;
+        }
 
         LOG_INFO_ARGS(COMP_RLDN_PROXY,"LdnProxy: SendTo %zu bytes from %08x:%u to %08x:%u",
                  bufferSize,
@@ -259,6 +440,76 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         return bufferSize;
     }
 
+    s32 LdnProxy::SendToBatch(const ProxyDatagram* datagrams, size_t count, const sockaddr_in* localEp, s32 protocolType) {
+        ScopedBuffer packet(g_sharedBufferPool);
+        if (!packet.Get()) {
+            LOG_ERR(COMP_RLDN_PROXY,"LdnProxy: Failed to borrow buffer for SendToBatch");
+            return -1;
+        }
+
+        constexpr size_t FrameOverhead = RyuLdnProtocol::HeaderSize + sizeof(ProxyDataHeaderFull);
+
+        size_t sent = 0;
+        size_t encoded = 0;
+        size_t offset = 0;
+        bool failed = false;
+        while (encoded < count) {
+            const ProxyDatagram& datagram = datagrams[encoded];
+            size_t payloadSize = 0;
+            for (size_t i = 0; i < datagram.segmentCount; i++) {
+                payloadSize += datagram.segmentSizes[i];
+            }
+
+            if (FrameOverhead + payloadSize > BufferPool::GetBufferSize()) {
+                LOG_WARN_ARGS(COMP_RLDN_PROXY,"LdnProxy: SendToBatch datagram too large (%zu bytes)", payloadSize);
+                break;
+            }
+
+            if (offset + FrameOverhead + payloadSize > BufferPool::GetBufferSize()) {
+                // Buffer full: write what we have and start over
+                if (_parent->SendRawPacket(packet.Get(), static_cast<int>(offset)) < 0) {
+                    failed = true;
+                    break;
+                }
+                sent = encoded;
+                offset = 0;
+            }
+
+            // Each datagram is its own ProxyData frame; frames are simply written back to back
+            ProxyDataHeaderFull header;
+            header.info = MakeInfo(localEp, &datagram.dest, protocolType);
+            header.dataLength = payloadSize;
+
+            if (DeliverLocally(header, datagram.segments, datagram.segmentSizes, datagram.segmentCount)) {
+                encoded++;
+                continue;
+            }
+
+            u8* frame = packet.Get() + offset;
+            RyuLdnProtocol::EncodeHeader(PacketId::ProxyData, sizeof(header) + payloadSize, frame);
+            std::memcpy(frame + RyuLdnProtocol::HeaderSize, &header, sizeof(header));
+
+            u8* payload = frame + FrameOverhead;
+            for (size_t i = 0; i < datagram.segmentCount; i++) {
+                std::memcpy(payload, datagram.segments[i], datagram.segmentSizes[i]);
+                payload += datagram.segmentSizes[i];
+            }
+
+            offset += FrameOverhead + payloadSize;
+            encoded++;
+        }
+
+        // Nothing left to write if the tail of the batch was delivered locally. After a failed write the
+        // same frames are not tried again: part of them may already be on the stream
+        if (!failed && (offset == 0 || _parent->SendRawPacket(packet.Get(), static_cast<int>(offset)) >= 0)) {
+            sent = encoded;
+        }
+
+        LOG_INFO_ARGS(COMP_RLDN_PROXY,"LdnProxy: SendToBatch %zu/%zu datagrams", sent, count);
+
+        return sent > 0 ? static_cast<s32>(sent) : -1;
+    }
+
     // BSD socket compatibility methods (temporary - for bsd_mitm_service)
     s32 LdnProxy::SendTo(s32 fd, const u8* buffer, size_t bufferSize, const sockaddr_in* dest) {
         // For now, just log and return success
@@ -296,6 +547,13 @@ namespace ams::mitm::ldn::ryuldn::proxy {
             UnregisterHandlers(_protocol);
         }
 
+        _parent->GetTimers().Unregister(_flushTimer);
+        _flushTimer = TimerQueue::InvalidTimerId;
+        {
+            std::scoped_lock lk(_pendingFlushMutex);
+            _pendingFlush.clear();
+        }
+
         std::scoped_lock lk(_socketsMutex);
         // Note: Sockets should close themselves, we don't call ProxyDestroyed()
         // as it doesn't exist in our C++ implementation
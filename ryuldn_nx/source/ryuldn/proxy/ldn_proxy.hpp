@@ -2,8 +2,10 @@
 // LDN Proxy - Virtual Network Proxy
 // Matches Ryujinx LdnRyu/Proxy/LdnProxy.cs
 #include "../types.hpp"
+#include "../../ryuldnnx_ipc_types.hpp"
 #include "proxy_helpers.hpp"
 #include "ephemeral_port_pool.hpp"
+#include "../timer_queue.hpp"
 #include <stratosphere.hpp>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -11,6 +13,7 @@
 #include <list>
 #include <unordered_map>
 #include <memory>
+#include <atomic>
 
 namespace ams::mitm::ldn::ryuldn {
 
@@ -22,6 +25,18 @@ namespace ams::mitm::ldn::ryuldn {
 
         // Forward declaration
         class LdnProxySocket;
+        class LdnProxySocketPool;
+        struct ProxyDataPacket;
+
+        // One outgoing datagram for SendToBatch; the payload is gathered from up to MaxSegments pieces
+        struct ProxyDatagram {
+            static constexpr size_t MaxSegments = 8;
+
+            sockaddr_in dest;
+            const u8* segments[MaxSegments];
+            size_t segmentSizes[MaxSegments];
+            size_t segmentCount;
+        };
 
         class LdnProxy {
         private:
@@ -30,6 +45,23 @@ namespace ams::mitm::ldn::ryuldn {
 
             std::list<LdnProxySocket*> _sockets;
             os::Mutex _socketsMutex;
+            LdnProxySocketPool* _socketPool;   // Accepted sockets come from here when set
+
+            // Sockets holding coalesced stream writes, flushed together by one timer
+            std::vector<LdnProxySocket*> _pendingFlush;
+            os::Mutex _pendingFlushMutex;
+            TimerQueue::TimerId _flushTimer;
+
+            // ProxyData frames decoded from the current read, routed together once the read is done.
+            // The payload still lives in the protocol's buffer and is only copied for a socket that takes it.
+            // Only touched by the thread feeding the protocol (master client worker).
+            struct InboundFrame {
+                ProxyDataHeaderFull header;
+                const u8* data;
+                size_t size;
+            };
+            std::vector<InboundFrame> _inboundBatch;
+            std::vector<LdnProxySocket*> _batchTouched;
 
             std::unordered_map<s32, std::unique_ptr<EphemeralPortPool>> _ephemeralPorts; // keyed by protocol type
 
@@ -37,10 +69,20 @@ namespace ams::mitm::ldn::ryuldn {
             u32 _localIp;
             u32 _broadcast;
 
+            std::atomic<u32> _slowConsumerMs;   // 0 = never flag slow consumers
+
+            // Traffic that never left the console (sent to our own IP, or our copy of a broadcast)
+            std::atomic<u64> _localDeliveredPackets;
+            std::atomic<u64> _localDeliveredBytes;
+
             void RegisterHandlers(RyuLdnProtocol* protocol);
             void ForRoutedSockets(const ProxyInfo& info, std::function<void(LdnProxySocket*)> action);
+            // Caller must hold _socketsMutex
+            static bool IsRoutedTo(LdnProxySocket* socket, const ProxyInfo& info);
+            void FlushInboundBatch();
             u32 GetIpV4(const sockaddr_in* endpoint);
-            ProxyInfo MakeInfo(const sockaddr_in* localEp, const sockaddr_in* remoteEp, s32 protocolType);
+            // Hands data to local sockets directly; returns true if it must not go to the server at all
+            bool DeliverLocally(const ProxyDataHeaderFull& header, const u8* const* segments, const size_t* segmentSizes, size_t segmentCount);
 
         public:
             LdnProxy(const ProxyConfig& config, LdnMasterProxyClient* client, RyuLdnProtocol* protocol);
@@ -57,6 +99,10 @@ namespace ams::mitm::ldn::ryuldn {
             void RegisterSocket(LdnProxySocket* socket);
             void UnregisterSocket(LdnProxySocket* socket);
 
+            // Sockets created on the proxy's side (accepted connections); the pool must outlive the proxy's sockets
+            void SetSocketPool(LdnProxySocketPool* pool) { _socketPool = pool; }
+            std::shared_ptr<LdnProxySocket> CreateSocket(s32 addressFamily, s32 socketType, s32 protocolType);
+
             // Protocol handlers (called by RyuLdnProtocol callbacks)
             void HandleConnectionRequest(const LdnHeader& header, const ProxyConnectRequestFull& request);
             void HandleConnectionResponse(const LdnHeader& header, const ProxyConnectResponseFull& response);
@@ -66,16 +112,37 @@ namespace ams::mitm::ldn::ryuldn {
             // Connection management
             void RequestConnection(const sockaddr_in* localEp, const sockaddr_in* remoteEp, s32 protocolType);
             void SignalConnected(const sockaddr_in* localEp, const sockaddr_in* remoteEp, s32 protocolType);
+            // Answers a connection request with a refusal (no source address), like a RST to a SYN
+            void RejectConnection(const ProxyConnectRequestFull& request);
             void EndConnection(const sockaddr_in* localEp, const sockaddr_in* remoteEp, s32 protocolType);
 
             // Data sending
+            ProxyInfo MakeInfo(const sockaddr_in* localEp, const sockaddr_in* remoteEp, s32 protocolType);
             s32 SendTo(const u8* buffer, size_t bufferSize, s32 flags, const sockaddr_in* localEp, const sockaddr_in* remoteEp, s32 protocolType);
+            // Same, with the routing info already built (connected sockets keep theirs)
+            s32 SendTo(const ProxyInfo& info, const u8* buffer, size_t bufferSize);
+            // Encodes as many datagrams as fit into one buffer per write; returns how many were sent, -1 if none
+            s32 SendToBatch(const ProxyDatagram* datagrams, size_t count, const sockaddr_in* localEp, s32 protocolType);
 
             // BSD socket compatibility methods (temporary)
             s32 SendTo(s32 fd, const u8* buffer, size_t bufferSize, const sockaddr_in* dest);
             Result RecvFrom(s32 fd, u8* buffer, size_t bufferSize, size_t* received, sockaddr_in* from);
             void CleanupSocket(s32 fd);
 
+            // Nagle delay: a socket's coalesced writes go out at most this long after the first one
+            static constexpr u64 CoalesceFlushDelayMs = 2;
+            void ScheduleFlush(LdnProxySocket* socket);
+            void FlushPending();
+
+            u64 GetLocalDeliveredPackets() const { return _localDeliveredPackets.load(std::memory_order_relaxed); }
+            u64 GetLocalDeliveredBytes() const { return _localDeliveredBytes.load(std::memory_order_relaxed); }
+
+            // A socket whose receive queue stays over half its limit this long is flagged as a slow consumer
+            void SetSlowConsumerWindow(u32 ms) { _slowConsumerMs.store(ms, std::memory_order_relaxed); }
+            u32 GetSlowConsumerWindow() const { return _slowConsumerMs.load(std::memory_order_relaxed); }
+            // Fills up to count entries, one per registered socket; returns how many were written
+            size_t GetSocketStats(RyuLdnSocketStats* out, size_t count);
+
             // IP utilities
             u32 GetLocalIP() const { return _localIp; }
             bool IsBroadcast(u32 ip) const { return ip == _broadcast; }
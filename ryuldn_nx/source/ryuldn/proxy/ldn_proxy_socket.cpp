@@ -5,37 +5,192 @@
 #include <arpa/inet.h>
 #include <cstring>
 #include <algorithm>
+#include <limits>
 
 namespace ams::mitm::ldn::ryuldn::proxy {
 
-    LdnProxySocket::LdnProxySocket(s32 addressFamily, s32 socketType, s32 protocolType, LdnProxy* proxy)
-        : _proxy(proxy),
+    namespace {
+
+        // Horizon's struct timeval, as passed to SO_RCVTIMEO/SO_SNDTIMEO
+        struct BsdTimeVal {
+            s64 tv_sec;
+            s64 tv_usec;
+        };
+
+        os::Tick MakeDeadline(TimeSpan timeout) {
+            return os::GetSystemTick() + os::ConvertToTick(timeout);
+        }
+
+        // Waits for the event, until the deadline if the timeout is set; false once it has passed
+        bool WaitUntil(os::SystemEvent& event, TimeSpan timeout, os::Tick deadline) {
+            if (timeout <= TimeSpan::FromNanoSeconds(0)) {
+                event.Wait();
+                return true;
+            }
+
+            const os::Tick now = os::GetSystemTick();
+            if (now >= deadline) {
+                return false;
+            }
+            return event.TimedWait(os::ConvertToTimeSpan(deadline - now));
+        }
+
+        s32 ToErrno(WsaError error) {
+            switch (error) {
+                case WsaError::WSAEWOULDBLOCK:  return EAGAIN;
+                case WsaError::WSAECONNREFUSED: return ECONNREFUSED;
+                case WsaError::WSAEINVAL:       return EINVAL;
+                case WsaError::WSAEOPNOTSUPP:   return EOPNOTSUPP;
+                case WsaError::WSAEISCONN:      return EISCONN;
+                case WsaError::WSAENOTCONN:     return ENOTCONN;
+                case WsaError::WSAESHUTDOWN:    return ESHUTDOWN;
+                case WsaError::WSAEMSGSIZE:     return EMSGSIZE;
+                case WsaError::WSAECONNRESET:   return ECONNRESET;
+            }
+            return EIO;
+        }
+
+    }
+
+    bool ProxyDataPacket::Create(ProxyDataPacket* out, const ProxyDataHeaderFull& header, const u8* const* segments, const size_t* segmentSizes, size_t segmentCount) {
+        size_t total = 0;
+        for (size_t i = 0; i < segmentCount; i++) {
+            total += segmentSizes[i];
+        }
+
+        u8* payload = new (std::nothrow) u8[total > 0 ? total : 1];
+        if (payload == nullptr) {
+            return false;
+        }
+
+        size_t offset = 0;
+        for (size_t i = 0; i < segmentCount; i++) {
+            std::memcpy(payload + offset, segments[i], segmentSizes[i]);
+            offset += segmentSizes[i];
+        }
+
+        out->header = header;
+        out->payload.reset(payload);
+        out->offset = 0;
+        out->size = total;
+        return true;
+    }
+
+    LdnProxySocket::LdnProxySocket()
+        : _proxy(nullptr),
           _isListening(false),
-          _listenSocketsMutex(false),
-          _connectRequestsMutex(false),
+          _backlog(1),
+          _acceptQueueMutex(false),
+          _backlogDrops(0),
           _acceptEvent(os::EventClearMode_AutoClear, false),
-          _acceptTimeout(-1),
           _errorsMutex(false),
           _connectEvent(os::EventClearMode_AutoClear, false),
-          _receiveTimeout(-1),
+          _receiveTimeout(TimeSpan::FromMilliSeconds(0)),
+          _sendTimeout(TimeSpan::FromMilliSeconds(0)),
           _receiveEvent(os::EventClearMode_AutoClear, false),
+          _receiveQueueBytes(0),
+          _receiveBufferSize(DefaultReceiveBufferSize),
+          _receiveOverflowed(false),
+          _receiveDrops(0),
+          _queueHighSince(0),
           _receiveQueueMutex(false),
+          _packetsIn(0),
+          _bytesIn(0),
+          _packetsOut(0),
+          _bytesOut(0),
+          _queueHighWater(0),
+          _lastReadTick(0),
+          _slowConsumer(false),
           _connecting(false),
+          _connectRefused(false),
           _broadcast(false),
           _readShutdown(false),
           _writeShutdown(false),
-          _closed(false),
+          _closed(true),
           _connected(false),
+          _acceptedFromPort(0),
           _isBound(false),
-          _addressFamily(addressFamily),
-          _socketType(socketType),
-          _protocolType(protocolType),
-          _blocking(true)
+          _addressFamily(0),
+          _socketType(0),
+          _protocolType(0),
+          _blocking(true),
+          _noDelay(false),
+          _noPush(false),
+          _coalesceMutex(false)
+    {
+        std::memset(&_remoteEndPoint, 0, sizeof(_remoteEndPoint));
+        std::memset(&_localEndPoint, 0, sizeof(_localEndPoint));
+        std::memset(&_connectResponse, 0, sizeof(_connectResponse));
+        std::memset(&_connectedInfo, 0, sizeof(_connectedInfo));
+    }
+
+    LdnProxySocket::LdnProxySocket(s32 addressFamily, s32 socketType, s32 protocolType, LdnProxy* proxy)
+        : LdnProxySocket()
     {
         LOG_HEAP(COMP_RLDN_PROXY_SOC,"LdnProxySocket constructor start");
+        Open(addressFamily, socketType, protocolType, proxy);
+        LOG_HEAP(COMP_RLDN_PROXY_SOC,"LdnProxySocket constructor end");
+    }
+
+    void LdnProxySocket::Open(s32 addressFamily, s32 socketType, s32 protocolType, LdnProxy* proxy) {
+        // A pooled socket keeps its events and containers; only its state starts over
+        _receiveEvent.Clear();
+        _acceptEvent.Clear();
+        _connectEvent.Clear();
+        {
+            std::scoped_lock lk(_receiveQueueMutex);
+            _receiveQueue = {};
+            _receiveQueueBytes = 0;
+            _receiveBufferSize = DefaultReceiveBufferSize;
+            _receiveOverflowed = false;
+            _queueHighSince = 0;
+        }
+        _receiveDrops = 0;
+        _packetsIn = 0;
+        _bytesIn = 0;
+        _packetsOut = 0;
+        _bytesOut = 0;
+        _queueHighWater = 0;
+        _lastReadTick = 0;
+        _slowConsumer = false;
+        {
+            std::scoped_lock lk(_errorsMutex);
+            _errors = {};
+        }
+        {
+            std::scoped_lock lk(_acceptQueueMutex);
+            _acceptQueue.clear();
+        }
+        _backlogDrops = 0;
+        {
+            std::scoped_lock lk(_coalesceMutex);
+            _coalesceBuffer.clear();
+        }
+
+        _proxy = proxy;
+        _isListening = false;
+        _backlog = 1;
+        _receiveTimeout = TimeSpan::FromMilliSeconds(0);
+        _sendTimeout = TimeSpan::FromMilliSeconds(0);
+        _connecting = false;
+        _connectRefused = false;
+        _broadcast = false;
+        _readShutdown = false;
+        _writeShutdown = false;
+        _connected = false;
+        _acceptedFromPort = 0;
+        _isBound = false;
+        _addressFamily = addressFamily;
+        _socketType = socketType;
+        _protocolType = protocolType;
+        _blocking = true;
+        _noDelay = false;
+        _noPush = false;
+
         std::memset(&_remoteEndPoint, 0, sizeof(_remoteEndPoint));
         std::memset(&_localEndPoint, 0, sizeof(_localEndPoint));
         std::memset(&_connectResponse, 0, sizeof(_connectResponse));
+        std::memset(&_connectedInfo, 0, sizeof(_connectedInfo));
 
         // Initialize socket options with defaults
         _socketOptions[SocketOptionName::Broadcast] = 0;
@@ -44,18 +199,19 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         _socketOptions[SocketOptionName::Error] = 0;
         _socketOptions[SocketOptionName::KeepAlive] = 0;
         _socketOptions[SocketOptionName::OutOfBandInline] = 0;
-        _socketOptions[SocketOptionName::ReceiveBuffer] = 131072;
-        _socketOptions[SocketOptionName::ReceiveTimeout] = -1;
+        _socketOptions[SocketOptionName::ReceiveBuffer] = DefaultReceiveBufferSize;
+        _socketOptions[SocketOptionName::ReceiveTimeout] = 0;
         _socketOptions[SocketOptionName::SendBuffer] = 131072;
-        _socketOptions[SocketOptionName::SendTimeout] = -1;
+        _socketOptions[SocketOptionName::SendTimeout] = 0;
         _socketOptions[SocketOptionName::Type] = socketType;
         _socketOptions[SocketOptionName::ReuseAddress] = 0;
 
+        _closed = false;
+
         // Register with proxy
         _proxy->RegisterSocket(this);
 
-        LOG_INFO_ARGS(COMP_RLDN_PROXY_SOC,"LdnProxySocket created: family=%d, type=%d, proto=%d", addressFamily, socketType, protocolType);
-        LOG_HEAP(COMP_RLDN_PROXY_SOC,"LdnProxySocket constructor end");
+        LOG_INFO_ARGS(COMP_RLDN_PROXY_SOC,"LdnProxySocket opened: family=%d, type=%d, proto=%d", addressFamily, socketType, protocolType);
     }
 
     LdnProxySocket::~LdnProxySocket() {
@@ -95,31 +251,124 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         _errors.push(static_cast<s32>(error));
     }
 
-    LdnProxySocket* LdnProxySocket::AsAccepted(const sockaddr_in& remoteEp) {
+    s32 LdnProxySocket::TakeError() {
+        std::scoped_lock lk(_errorsMutex);
+        if (_errors.empty()) {
+            return 0;
+        }
+        const WsaError error = static_cast<WsaError>(_errors.front());
+        _errors.pop();
+        return ToErrno(error);
+    }
+
+    void LdnProxySocket::SetConnected(const sockaddr_in& remoteEp) {
+        // Routing info first: IsRoutedFrom reads it as soon as _connected is set
+        {
+            std::scoped_lock lk(_peerMutex);
+            _remoteEndPoint = remoteEp;
+            _connectedInfo = _proxy->MakeInfo(&_localEndPoint, &_remoteEndPoint, _protocolType);
+        }
         _connected = true;
-        _remoteEndPoint = remoteEp;
+    }
 
+    LdnProxySocket* LdnProxySocket::AsAccepted(const sockaddr_in& remoteEp, u16 listenPort) {
         sockaddr_in localEp = EnsureLocalEndpoint(true);
+        _acceptedFromPort = listenPort;
+        SetConnected(remoteEp);
 
         _proxy->SignalConnected(&localEp, &remoteEp, _protocolType);
 
         return this;
     }
 
-    void LdnProxySocket::IncomingData(const ProxyDataPacket& packet) {
+    bool LdnProxySocket::IncomingData(const ProxyDataPacket& packet, bool signal) {
+        // A listener has no byte stream of its own, stream data for its port belongs to accepted sockets
+        if (_isListening) {
+            return false;
+        }
+
         bool isBroadcast = _proxy->IsBroadcast(packet.header.info.destIpV4);
 
         if (!_closed && (_broadcast || !isBroadcast)) {
             std::scoped_lock lk(_receiveQueueMutex);
+
+            const size_t limit = ReceiveLimitLocked();
+            if (_receiveOverflowed || _receiveQueueBytes + packet.Size() > limit) {
+                _receiveDrops.fetch_add(1, std::memory_order_relaxed);
+                if (_protocolType == IPPROTO_TCP && !_receiveOverflowed) {
+                    LOG_WARN_ARGS(COMP_RLDN_PROXY_SOC,"LdnProxySocket: stream receive queue over %zu bytes, resetting connection", limit);
+                    _receiveOverflowed = true;
+                    SignalError(WsaError::WSAECONNRESET);
+                    _receiveEvent.Signal();
+                }
+                return false;
+            }
+
             _receiveQueue.push(packet);
-            _receiveEvent.Signal();
+            _receiveQueueBytes += packet.Size();
+            _packetsIn.fetch_add(1, std::memory_order_relaxed);
+            _bytesIn.fetch_add(packet.Size(), std::memory_order_relaxed);
+            if (_receiveQueueBytes > _queueHighWater.load(std::memory_order_relaxed)) {
+                _queueHighWater.store(static_cast<u32>(_receiveQueueBytes), std::memory_order_relaxed);
+            }
+            TrackQueueDepthLocked();
+            if (signal) {
+                _receiveEvent.Signal();
+            }
+            return true;
         }
+
+        return false;
     }
 
     void LdnProxySocket::IncomingConnectionRequest(const ProxyConnectRequestFull& request) {
-        std::scoped_lock lk(_connectRequestsMutex);
-        _connectRequests.push(request);
-        _acceptEvent.Signal();
+        // Runs on the master client worker thread (under the proxy's socket list lock)
+        if (!_isListening || _closed) {
+            return;
+        }
+
+        // Is this request made for us?
+        sockaddr_in endpoint = GetEndpoint(request.info.destIpV4, request.info.destPort);
+        if (endpoint.sin_addr.s_addr != _localEndPoint.sin_addr.s_addr ||
+            endpoint.sin_port != _localEndPoint.sin_port) {
+            return;
+        }
+
+        bool full = false;
+        {
+            std::scoped_lock lk(_acceptQueueMutex);
+            full = _acceptQueue.size() >= static_cast<size_t>(_backlog);
+            if (full) {
+                _backlogDrops.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if (full) {
+            // The relay never retransmits a request, so the peer is refused instead of left waiting
+            LOG_WARN_ARGS(COMP_RLDN_PROXY_SOC,"LdnProxySocket: accept backlog full (%d), refusing connection from %08x:%u",
+                          _backlog, request.info.sourceIpV4, request.info.sourcePort);
+            _proxy->RejectConnection(request);
+            return;
+        }
+
+        // The handshake is completed right away, so several joiners connect in parallel
+        // instead of one per accept() call; the socket must exist first to catch early data
+        std::shared_ptr<LdnProxySocket> socket = _proxy->CreateSocket(_addressFamily, _socketType, _protocolType);
+        if (!socket) {
+            LOG_ERR(COMP_RLDN_PROXY_SOC,"LdnProxySocket: Failed to allocate accepted socket - out of memory");
+            _proxy->RejectConnection(request);
+            return;
+        }
+        socket->AsAccepted(GetEndpoint(request.info.sourceIpV4, request.info.sourcePort), ntohs(_localEndPoint.sin_port));
+
+        {
+            std::scoped_lock lk(_acceptQueueMutex);
+            if (!_closed) {
+                _acceptQueue.push_back(std::move(socket));
+                _acceptEvent.Signal();
+                return;
+            }
+        }
+        // Listener closed meanwhile; the socket is released here, outside the queue lock
     }
 
     void LdnProxySocket::HandleConnectResponse(const ProxyConnectResponseFull& response) {
@@ -131,75 +380,60 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         _connectResponse = response;
 
         if (response.info.sourceIpV4 != 0) {
-            _remoteEndPoint = GetEndpoint(response.info.sourceIpV4, response.info.sourcePort);
-            _connected = true;
+            // Always taken from the reply: an optimistic connect was pinned to the listen port,
+            // the accepted socket has a port of its own
+            SetConnected(GetEndpoint(response.info.sourceIpV4, response.info.sourcePort));
         } else {
             // Connection failed
             SignalError(WsaError::WSAECONNREFUSED);
+            _connectRefused = true;
+            if (_connected) {
+                // Optimistic writes went nowhere; pending coalesced bytes are dropped by the next flush
+                LOG_WARN(COMP_RLDN_PROXY_SOC,"LdnProxySocket: Optimistic connect refused by peer");
+                _connected = false;
+                _receiveEvent.Signal();
+            }
         }
 
         _connectEvent.Signal();
     }
 
     void LdnProxySocket::HandleDisconnect([[maybe_unused]] const ProxyDisconnectMessageFull& msg) {
+        // A connector giving up before its reply addresses the listen port; the accepted socket handles it
+        if (_isListening) {
+            return;
+        }
+
+        // The peer is gone: what is already queued can still be read, then recv() reports EOF
+        _readShutdown = true;
         Disconnect(false);
+        _receiveEvent.Signal();
     }
 
-    void LdnProxySocket::Accept(LdnProxySocket** out_socket) {
+    std::shared_ptr<LdnProxySocket> LdnProxySocket::Accept() {
         if (!_isListening) {
-            *out_socket = nullptr;
-            return; // Error: not listening
+            return nullptr; // Error: not listening
         }
 
-        {
-            std::scoped_lock lk(_connectRequestsMutex);
-            if (!_blocking && _connectRequests.empty()) {
-                *out_socket = nullptr;
-                return; // WSAEWOULDBLOCK
-            }
-        }
+        const TimeSpan timeout = _receiveTimeout;
+        const os::Tick deadline = MakeDeadline(timeout);
 
         while (true) {
-            _acceptEvent.TimedWait(TimeSpan::FromMilliSeconds(_acceptTimeout < 0 ? -1 : _acceptTimeout));
-
-            std::scoped_lock lk(_connectRequestsMutex);
-            while (!_connectRequests.empty()) {
-                ProxyConnectRequestFull request = _connectRequests.front();
-                _connectRequests.pop();
-
-                if (!_connectRequests.empty()) {
-                    _acceptEvent.Signal(); // Still more accepts to do
+            {
+                std::scoped_lock lk(_acceptQueueMutex);
+                if (!_acceptQueue.empty()) {
+                    std::shared_ptr<LdnProxySocket> socket = std::move(_acceptQueue.front());
+                    _acceptQueue.pop_front();
+                    return socket;
                 }
-
-                // Is this request made for us?
-                sockaddr_in endpoint = GetEndpoint(request.info.destIpV4, request.info.destPort);
-
-                if (endpoint.sin_addr.s_addr == _localEndPoint.sin_addr.s_addr &&
-                    endpoint.sin_port == _localEndPoint.sin_port) {
-                    // Yes - let's accept
-                    sockaddr_in remoteEndpoint = GetEndpoint(request.info.sourceIpV4, request.info.sourcePort);
-
-                    LOG_HEAP(COMP_RLDN_PROXY_SOC,"before LdnProxySocket");
-                    LdnProxySocket* socket = new (std::nothrow) LdnProxySocket(_addressFamily, _socketType, _protocolType, _proxy);
-                    if (socket == nullptr) {
-                        LOG_INFO(COMP_RLDN_PROXY_SOC,"ERROR: Failed to allocate LdnProxySocket - out of memory");
-                        LOG_HEAP(COMP_RLDN_PROXY_SOC,"after LdnProxySocket FAILED");
-                        *out_socket = nullptr;
-                        return;
-                    }
-                    LOG_HEAP(COMP_RLDN_PROXY_SOC,"after LdnProxySocket");
-
-                    socket->AsAccepted(remoteEndpoint);
-
-                    {
-                        std::scoped_lock listen_lk(_listenSocketsMutex);
-                        _listenSockets.push_back(socket);
-                    }
-
-                    *out_socket = socket;
-                    return;
+                if (_closed || !_blocking) {
+                    return nullptr; // WSAEWOULDBLOCK
                 }
             }
+
+            if (!WaitUntil(_acceptEvent, timeout, deadline)) {
+                return nullptr; // SO_RCVTIMEO elapsed
+            }
         }
     }
 
@@ -230,60 +464,138 @@ namespace ams::mitm::ldn::ryuldn::proxy {
 
         _closed = true;
 
+        FlushCoalesced();
         _proxy->UnregisterSocket(this);
 
         if (_connected) {
             Disconnect(false);
         }
 
+        // Established connections nobody accepted are reset; released outside the queue lock
+        // since closing them takes the proxy's socket list lock
+        std::deque<std::shared_ptr<LdnProxySocket>> unaccepted;
         {
-            std::scoped_lock lk(_listenSocketsMutex);
-            for (auto* socket : _listenSockets) {
-                socket->Close();
-            }
-            _listenSockets.clear();
+            std::scoped_lock lk(_acceptQueueMutex);
+            unaccepted.swap(_acceptQueue);
         }
+        unaccepted.clear();
 
         _isListening = false;
 
+        // Release threads still blocked in Receive/Accept/Connect on this socket
+        _receiveEvent.Signal();
+        _acceptEvent.Signal();
+        _connectEvent.Signal();
+
         LOG_INFO(COMP_RLDN_PROXY_SOC,"LdnProxySocket::Close");
     }
 
-    void LdnProxySocket::Connect(const sockaddr_in* remoteEP) {
-        if (_isListening || !_isBound) {
-            return; // Error: invalid operation
+    s32 LdnProxySocket::Connect(const sockaddr_in* remoteEP, bool optimistic) {
+        if (remoteEP == nullptr) {
+            errno = EFAULT;
+            return -1;
         }
 
-        if (remoteEP == nullptr) {
-            return; // Error
+        if (_protocolType == IPPROTO_UDP) {
+            // A datagram connect has no handshake: it only fixes the peer (and binds implicitly)
+            if (!_isBound) {
+                EnsureLocalEndpoint(false);
+                _isBound = true;
+            }
+            SetConnected(*remoteEP);
+            LOG_INFO_ARGS(COMP_RLDN_PROXY_SOC,"LdnProxySocket::Connect - UDP peer %08x:%u", ntohl(remoteEP->sin_addr.s_addr), ntohs(remoteEP->sin_port));
+            return 0;
         }
 
-        sockaddr_in localEp = EnsureLocalEndpoint(true);
+        if (_connected) {
+            errno = EISCONN;
+            return -1;
+        }
+        if (_connecting) {
+            errno = EALREADY;
+            return -1;
+        }
+        if (_isListening) {
+            errno = EINVAL;
+            return -1;
+        }
 
+        // Like the UDP path, connecting an unbound socket binds it to an ephemeral port
+        sockaddr_in localEp;
+        if (!_isBound) {
+            localEp = EnsureLocalEndpoint(false);
+            _isBound = true;
+        } else {
+            localEp = EnsureLocalEndpoint(true);
+        }
+
+        _connectEvent.Clear();
+        _connectRefused = false;
+        {
+            // Errors of an earlier attempt must not be reported for this one
+            std::scoped_lock lk(_errorsMutex);
+            _errors = {};
+        }
         _connecting = true;
 
         _proxy->RequestConnection(&localEp, remoteEP, _protocolType);
 
-        if (!_blocking && _protocolType == IPPROTO_TCP) {
-            return; // WSAEWOULDBLOCK
+        // The relay keeps frames in order, so data sent now reaches the peer right after its accepted
+        // socket exists, which also listens on the listen port for us; the reply then moves us to the
+        // accepted socket's own port, or a refusal undoes the connect. Connecting to ourselves
+        // is excluded since that data would be delivered locally ahead of the request.
+        if (optimistic && ntohl(remoteEP->sin_addr.s_addr) != _proxy->GetLocalIP()) {
+            SetConnected(*remoteEP);
+            LOG_INFO_ARGS(COMP_RLDN_PROXY_SOC,"LdnProxySocket::Connect - optimistic to %08x:%u", ntohl(remoteEP->sin_addr.s_addr), ntohs(remoteEP->sin_port));
+            if (!_blocking) {
+                errno = EINPROGRESS;   // Already writable, the first poll completes it
+                return -1;
+            }
+            return 0;
         }
 
-        _connectEvent.Wait();
+        if (!_blocking) {
+            errno = EINPROGRESS;
+            return -1;
+        }
 
-        if (_connectResponse.info.sourceIpV4 == 0) {
-            // Connection refused
-            return; // Error
+        // Like Linux, a blocking connect gives up after SO_SNDTIMEO
+        const TimeSpan timeout = _sendTimeout;
+        const os::Tick deadline = MakeDeadline(timeout);
+        while (_connecting && !_closed) {
+            if (!WaitUntil(_connectEvent, timeout, deadline)) {
+                break;
+            }
+        }
+
+        if (_connected) {
+            _connectResponse = {}; // Reset
+            LOG_INFO(COMP_RLDN_PROXY_SOC,"LdnProxySocket::Connect - connected");
+            return 0;
         }
 
-        _connectResponse = {}; // Reset
-        LOG_INFO(COMP_RLDN_PROXY_SOC,"LdnProxySocket::Connect - connected");
+        if (_connecting) {
+            // A late reply is ignored once we stop waiting for it
+            _connecting = false;
+            errno = _closed ? ECONNABORTED : ETIMEDOUT;
+        } else {
+            errno = ECONNREFUSED;
+        }
+        return -1;
     }
 
     void LdnProxySocket::Disconnect([[maybe_unused]] bool reuseSocket) {
         if (_connected) {
-            _proxy->EndConnection(&_localEndPoint, &_remoteEndPoint, _protocolType);
+            FlushCoalesced();
+            if (_protocolType == IPPROTO_TCP) {
+                const sockaddr_in remoteEp = GetRemoteEndPoint();
+                _proxy->EndConnection(&_localEndPoint, &remoteEp, _protocolType);
+            }
 
-            std::memset(&_remoteEndPoint, 0, sizeof(_remoteEndPoint));
+            {
+                std::scoped_lock lk(_peerMutex);
+                std::memset(&_remoteEndPoint, 0, sizeof(_remoteEndPoint));
+            }
             _connected = false;
         }
 
@@ -295,94 +607,148 @@ namespace ams::mitm::ldn::ryuldn::proxy {
             return; // Error
         }
 
+        _backlog = std::clamp(backlog, 1, MaxBacklog);
         _isListening = true;
 
-        LOG_INFO_ARGS(COMP_RLDN_PROXY_SOC,"LdnProxySocket::Listen - backlog %d", backlog);
+        LOG_INFO_ARGS(COMP_RLDN_PROXY_SOC,"LdnProxySocket::Listen - backlog %d", _backlog);
     }
 
     s32 LdnProxySocket::Receive(u8* buffer, size_t bufferSize, s32 flags) {
-        sockaddr_in dummy;
-        return ReceiveFrom(buffer, bufferSize, flags, &dummy);
+        return ReceiveFrom(buffer, bufferSize, flags, nullptr);
     }
 
-    s32 LdnProxySocket::ReceiveFrom(u8* buffer, size_t bufferSize, s32 flags, sockaddr_in* outSrcAddr) {
-        if (!_connected && _protocolType == IPPROTO_TCP) {
-            return -1; // WSAECONNRESET
-        }
+    size_t LdnProxySocket::ReceiveLimitLocked() const {
+        // The relay has no flow control, so the queue is bounded here instead of by the sender.
+        // Datagrams are dropped like a full UDP buffer would; a stream gets StreamReceiveSlack
+        // times the buffer (it cannot lose bytes silently) and is reset past that.
+        return _protocolType == IPPROTO_TCP ? _receiveBufferSize * StreamReceiveSlack : _receiveBufferSize;
+    }
 
-        {
-            std::scoped_lock lk(_receiveQueueMutex);
-            if (!_receiveQueue.empty()) {
-                ProxyDataPacket& packet = _receiveQueue.front();
-                *outSrcAddr = GetEndpoint(packet.header.info.sourceIpV4, packet.header.info.sourcePort);
-
-                bool peek = (flags & MSG_PEEK) != 0;
-                size_t read;
-
-                if (packet.data.size() > bufferSize) {
-                    read = bufferSize;
-                    std::memcpy(buffer, packet.data.data(), bufferSize);
-
-                    if (_protocolType == IPPROTO_UDP) {
-                        // UDP overflows, loses the data
-                        if (!peek) {
-                            _receiveQueue.pop();
-                        }
-                        return -1; // WSAEMSGSIZE
-                    } else if (_protocolType == IPPROTO_TCP) {
-                        // TCP splits data
-                        std::vector<u8> newData(packet.data.begin() + bufferSize, packet.data.end());
-                        packet.data = std::move(newData);
-                    }
-                } else {
-                    read = packet.data.size();
-                    std::memcpy(buffer, packet.data.data(), read);
+    void LdnProxySocket::TrackQueueDepthLocked() {
+        if (_receiveQueueBytes <= ReceiveLimitLocked() / 2) {
+            _queueHighSince = 0;
+            return;
+        }
 
-                    if (!peek) {
-                        _receiveQueue.pop();
-                    }
-                }
+        const s64 now = os::GetSystemTick().GetInt64Value();
+        if (_queueHighSince == 0) {
+            _queueHighSince = now;
+            return;
+        }
 
-                return read;
-            } else if (_readShutdown) {
-                return 0;
-            } else if (!_blocking) {
-                return -1; // WSAEWOULDBLOCK
-            }
+        const u32 windowMs = _proxy->GetSlowConsumerWindow();
+        if (windowMs != 0 && !_slowConsumer.load(std::memory_order_relaxed) &&
+            os::ConvertToTimeSpan(os::Tick(now - _queueHighSince)).GetMilliSeconds() >= windowMs) {
+            _slowConsumer.store(true, std::memory_order_relaxed);
+            LOG_WARN_ARGS(COMP_RLDN_PROXY_SOC,"LdnProxySocket: port %u is a slow consumer (%zu bytes queued for over %u ms)",
+                     ntohs(_localEndPoint.sin_port), _receiveQueueBytes, windowMs);
         }
+    }
 
-        s32 timeout = _receiveTimeout;
-        if (timeout == 0) timeout = -1;
+    s32 LdnProxySocket::CountSent(s32 result, size_t packets) {
+        if (result >= 0) {
+            _packetsOut.fetch_add(packets, std::memory_order_relaxed);
+            _bytesOut.fetch_add(static_cast<u64>(result), std::memory_order_relaxed);
+        }
+        return result;
+    }
 
-        _receiveEvent.TimedWait(TimeSpan::FromMilliSeconds(timeout));
+    s32 LdnProxySocket::DequeueLocked(u8* buffer, size_t bufferSize, s32 flags, sockaddr_in* outSrcAddr) {
+        _lastReadTick.store(os::GetSystemTick().GetInt64Value(), std::memory_order_relaxed);
 
-        if (!_connected && _protocolType == IPPROTO_TCP) {
-            return -1; // WSAECONNRESET
+        ProxyDataPacket& packet = _receiveQueue.front();
+        if (outSrcAddr) {
+            *outSrcAddr = GetEndpoint(packet.header.info.sourceIpV4, packet.header.info.sourcePort);
         }
 
-        std::scoped_lock lk(_receiveQueueMutex);
-        if (!_receiveQueue.empty()) {
-            ProxyDataPacket& packet = _receiveQueue.front();
-            *outSrcAddr = GetEndpoint(packet.header.info.sourceIpV4, packet.header.info.sourcePort);
+        bool peek = (flags & MSG_PEEK) != 0;
+        size_t read;
 
-            size_t read = std::min(bufferSize, packet.data.size());
-            std::memcpy(buffer, packet.data.data(), read);
+        if (packet.Size() > bufferSize) {
+            read = bufferSize;
+            std::memcpy(buffer, packet.Data(), bufferSize);
 
-            if ((flags & MSG_PEEK) == 0) {
+            if (_protocolType == IPPROTO_UDP) {
+                // UDP overflows, loses the data
+                if (!peek) {
+                    _receiveQueueBytes -= packet.Size();
+                    _receiveQueue.pop();
+                    TrackQueueDepthLocked();
+                }
+                errno = EMSGSIZE;
+                return -1;
+            } else if (_protocolType == IPPROTO_TCP && !peek) {
+                // TCP splits data; the rest stays in the shared payload
+                packet.offset += bufferSize;
+                packet.size -= bufferSize;
+                _receiveQueueBytes -= bufferSize;
+                TrackQueueDepthLocked();
+            }
+        } else {
+            read = packet.Size();
+            std::memcpy(buffer, packet.Data(), read);
+
+            if (!peek) {
+                _receiveQueueBytes -= read;
                 _receiveQueue.pop();
+                TrackQueueDepthLocked();
             }
+        }
 
-            return read;
-        } else if (_readShutdown) {
-            return 0;
-        } else {
-            return -1; // WSAETIMEDOUT
+        return static_cast<s32>(read);
+    }
+
+    s32 LdnProxySocket::ReceiveFrom(u8* buffer, size_t bufferSize, s32 flags, sockaddr_in* outSrcAddr, TimeSpan callTimeout) {
+        // A reader is likely waiting on the answer to what it just wrote, don't hold that back
+        if (_protocolType == IPPROTO_TCP && !_noPush) {
+            FlushCoalesced();
+        }
+
+        const bool nonBlocking = !_blocking || (flags & MSG_DONTWAIT) != 0;
+        const TimeSpan zero = TimeSpan::FromNanoSeconds(0);
+        const TimeSpan timeout = callTimeout > zero && (_receiveTimeout <= zero || callTimeout < _receiveTimeout) ?
+                                 callTimeout : _receiveTimeout;
+        const os::Tick deadline = MakeDeadline(timeout);
+
+        while (true) {
+            {
+                std::scoped_lock lk(_receiveQueueMutex);
+                if (!_receiveQueue.empty()) {
+                    return DequeueLocked(buffer, bufferSize, flags, outSrcAddr);
+                } else if (_receiveOverflowed) {
+                    errno = ECONNRESET;
+                    return -1;
+                } else if (_readShutdown) {
+                    return 0;
+                } else if (_protocolType == IPPROTO_TCP && !_connected) {
+                    errno = _connectRefused ? ECONNREFUSED : ENOTCONN;
+                    return -1;
+                } else if (_closed) {
+                    errno = EBADF;
+                    return -1;
+                } else if (nonBlocking) {
+                    errno = EAGAIN;
+                    return -1;
+                }
+            }
+
+            // An expired SO_RCVTIMEO reports EWOULDBLOCK, as on BSD
+            if (!WaitUntil(_receiveEvent, timeout, deadline)) {
+                errno = EAGAIN;
+                return -1;
+            }
         }
     }
 
     s32 LdnProxySocket::Send(const u8* buffer, size_t bufferSize, s32 flags) {
         if (!_connected) {
-            return -1; // Error
+            errno = _connectRefused ? ECONNREFUSED : ENOTCONN;
+            return -1;
+        }
+
+        // Connected datagrams skip the endpoint checks and go out with the prebuilt routing info
+        if (_protocolType == IPPROTO_UDP) {
+            return CountSent(_proxy->SendTo(GetConnectedInfo(), buffer, bufferSize));
         }
 
         return SendTo(buffer, bufferSize, flags, &_remoteEndPoint);
@@ -390,16 +756,113 @@ namespace ams::mitm::ldn::ryuldn::proxy {
 
     s32 LdnProxySocket::SendTo(const u8* buffer, size_t bufferSize, s32 flags, const sockaddr_in* destAddr) {
         if (!_connected && _protocolType == IPPROTO_TCP) {
-            return -1; // WSAECONNRESET
+            errno = _connectRefused ? ECONNREFUSED : ENOTCONN;
+            return -1;
+        }
+        if (_writeShutdown) {
+            errno = EPIPE;
+            return -1;
         }
 
         sockaddr_in localEp = EnsureLocalEndpoint(false);
 
         if (destAddr == nullptr) {
-            return -1; // Error
+            errno = EDESTADDRREQ;
+            return -1;
+        }
+
+        if (_protocolType != IPPROTO_TCP) {
+            return CountSent(_proxy->SendTo(buffer, bufferSize, flags, &localEp, destAddr, _protocolType));
+        }
+        if (_noDelay && !_noPush) {
+            FlushCoalesced();
+            return CountSent(_proxy->SendTo(GetConnectedInfo(), buffer, bufferSize));
+        }
+
+        // Stream writes always go to the connected peer, merge small ones into one frame
+        bool schedule = false;
+        {
+            std::scoped_lock lk(_coalesceMutex);
+            const ProxyInfo info = GetConnectedInfo();
+            if (_coalesceBuffer.size() + bufferSize > CoalesceThreshold && !_coalesceBuffer.empty()) {
+                if (_proxy->SendTo(info, _coalesceBuffer.data(), _coalesceBuffer.size()) < 0) {
+                    // Dropped like FlushCoalesced does: kept, they would go out ahead of later writes
+                    LOG_WARN_ARGS(COMP_RLDN_PROXY_SOC,"LdnProxySocket: Dropped %zu coalesced bytes, master connection unavailable", _coalesceBuffer.size());
+                    _coalesceBuffer.clear();
+                    errno = ENOTCONN;
+                    return -1;
+                }
+                _coalesceBuffer.clear();
+            }
+
+            if (bufferSize >= CoalesceThreshold) {
+                return CountSent(_proxy->SendTo(info, buffer, bufferSize));
+            }
+
+            schedule = _coalesceBuffer.empty() && !_noPush;
+            _coalesceBuffer.insert(_coalesceBuffer.end(), buffer, buffer + bufferSize);
         }
 
-        return _proxy->SendTo(buffer, bufferSize, flags, &localEp, destAddr, _protocolType);
+        // Scheduled outside _coalesceMutex: the flush timer takes the locks in the opposite order
+        if (schedule) {
+            _proxy->ScheduleFlush(this);
+        }
+        return CountSent(static_cast<s32>(bufferSize));
+    }
+
+    void LdnProxySocket::FlushCoalesced() {
+        std::scoped_lock lk(_coalesceMutex);
+        if (_coalesceBuffer.empty() || !_connected) {
+            _coalesceBuffer.clear();
+            return;
+        }
+
+        if (_proxy->SendTo(GetConnectedInfo(), _coalesceBuffer.data(), _coalesceBuffer.size()) < 0) {
+            LOG_WARN_ARGS(COMP_RLDN_PROXY_SOC,"LdnProxySocket: Dropped %zu coalesced bytes, master connection unavailable", _coalesceBuffer.size());
+        }
+        _coalesceBuffer.clear();
+    }
+
+    s32 LdnProxySocket::SendToBatch(const ProxyDatagram* datagrams, size_t count) {
+        if (!_connected && _protocolType == IPPROTO_TCP) {
+            errno = _connectRefused ? ECONNREFUSED : ENOTCONN;
+            return -1;
+        }
+
+        if (count == 0) {
+            return 0;
+        }
+
+        if (_protocolType == IPPROTO_TCP) {
+            // A stream has one peer and one byte order: every message goes through SendTo, behind
+            // any coalesced writes and to the connected peer whatever msg_name says
+            s32 written = 0;
+            for (size_t i = 0; i < count; i++) {
+                for (size_t j = 0; j < datagrams[i].segmentCount; j++) {
+                    if (datagrams[i].segmentSizes[j] != 0 &&
+                        SendTo(datagrams[i].segments[j], datagrams[i].segmentSizes[j], 0, &_remoteEndPoint) < 0) {
+                        return written > 0 ? written : -1;
+                    }
+                }
+                written++;
+            }
+            return written;
+        }
+
+        sockaddr_in localEp = EnsureLocalEndpoint(false);
+
+        const s32 sent = _proxy->SendToBatch(datagrams, count, &localEp, _protocolType);
+        if (sent > 0) {
+            size_t bytes = 0;
+            for (s32 i = 0; i < sent; i++) {
+                for (size_t j = 0; j < datagrams[i].segmentCount; j++) {
+                    bytes += datagrams[i].segmentSizes[j];
+                }
+            }
+            _packetsOut.fetch_add(sent, std::memory_order_relaxed);
+            _bytesOut.fetch_add(bytes, std::memory_order_relaxed);
+        }
+        return sent;
     }
 
     void LdnProxySocket::Shutdown(s32 how) {
@@ -408,6 +871,7 @@ namespace ams::mitm::ldn::ryuldn::proxy {
             _receiveEvent.Signal();
         }
         if (how == SHUT_WR || how == SHUT_RDWR) {
+            FlushCoalesced();
             _writeShutdown = true;
         }
 
@@ -425,8 +889,11 @@ namespace ams::mitm::ldn::ryuldn::proxy {
     void LdnProxySocket::SetSocketOption(SocketOptionName optionName, s32 optionValue) {
         _socketOptions[optionName] = optionValue;
 
-        if (optionName == SocketOptionName::ReceiveTimeout) {
-            _receiveTimeout = optionValue;
+        if (optionName == SocketOptionName::ReceiveTimeout || optionName == SocketOptionName::SendTimeout) {
+            SetTimeout(optionName, TimeSpan::FromMilliSeconds(optionValue > 0 ? optionValue : 0));
+        } else if (optionName == SocketOptionName::ReceiveBuffer) {
+            std::scoped_lock lk(_receiveQueueMutex);
+            _receiveBufferSize = std::clamp<size_t>(optionValue > 0 ? optionValue : 0, MinReceiveBufferSize, MaxReceiveBufferSize);
         } else if (optionName == SocketOptionName::Broadcast) {
             _broadcast = (optionValue != 0);
         }
@@ -434,27 +901,33 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         LOG_INFO_ARGS(COMP_RLDN_PROXY_SOC,"LdnProxySocket::SetSocketOption - %d = %d", static_cast<s32>(optionName), optionValue);
     }
 
+    void LdnProxySocket::SetTimeout(SocketOptionName optionName, TimeSpan timeout) {
+        // The option map keeps whole milliseconds (rounded up) for GetSocketOption
+        const s64 ms = (timeout.GetNanoSeconds() + 999999) / 1000000;
+        _socketOptions[optionName] = static_cast<s32>(std::min<s64>(ms, std::numeric_limits<s32>::max()));
+
+        if (optionName == SocketOptionName::ReceiveTimeout) {
+            _receiveTimeout = timeout;
+        } else if (optionName == SocketOptionName::SendTimeout) {
+            _sendTimeout = timeout;
+        }
+    }
+
     s32 LdnProxySocket::GetAvailable() const {
         std::scoped_lock lk(_receiveQueueMutex);
-        s32 result = 0;
-        std::queue<ProxyDataPacket> tempQueue = _receiveQueue;
-        while (!tempQueue.empty()) {
-            result += tempQueue.front().data.size();
-            tempQueue.pop();
-        }
-        return result;
+        return static_cast<s32>(_receiveQueueBytes);
     }
 
     bool LdnProxySocket::IsReadable() const {
         if (_isListening) {
-            std::scoped_lock lk(_connectRequestsMutex);
-            return !_connectRequests.empty();
+            std::scoped_lock lk(_acceptQueueMutex);
+            return !_acceptQueue.empty();
         } else {
             if (_readShutdown) {
                 return true;
             }
             std::scoped_lock lk(_receiveQueueMutex);
-            return !_receiveQueue.empty();
+            return !_receiveQueue.empty() || _receiveOverflowed;
         }
     }
 
@@ -462,46 +935,94 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         return _connected || _protocolType == IPPROTO_UDP;
     }
 
+    void LdnProxySocket::GetStats(RyuLdnSocketStats* out) const {
+        std::memset(out, 0, sizeof(*out));
+        out->local_ip = ntohl(_localEndPoint.sin_addr.s_addr);
+        out->local_port = ntohs(_localEndPoint.sin_port);
+        out->protocol = static_cast<u8>(_protocolType);
+        if (_connected) {
+            const sockaddr_in remoteEp = GetRemoteEndPoint();
+            out->remote_ip = ntohl(remoteEp.sin_addr.s_addr);
+            out->remote_port = ntohs(remoteEp.sin_port);
+        }
+
+        out->packets_in = _packetsIn.load(std::memory_order_relaxed);
+        out->bytes_in = _bytesIn.load(std::memory_order_relaxed);
+        out->packets_out = _packetsOut.load(std::memory_order_relaxed);
+        out->bytes_out = _bytesOut.load(std::memory_order_relaxed);
+        out->queue_high_water = _queueHighWater.load(std::memory_order_relaxed);
+        out->backlog_drops = _backlogDrops.load(std::memory_order_relaxed);
+        out->receive_drops = _receiveDrops.load(std::memory_order_relaxed);
+
+        const s64 now = os::GetSystemTick().GetInt64Value();
+        const s64 lastRead = _lastReadTick.load(std::memory_order_relaxed);
+        out->ms_since_last_read = lastRead == 0 ? -1 : os::ConvertToTimeSpan(os::Tick(now - lastRead)).GetMilliSeconds();
+
+        // A reader that stopped entirely never re-evaluates the queue, so the window is checked here too
+        const u32 windowMs = _proxy->GetSlowConsumerWindow();
+        bool slow = _slowConsumer.load(std::memory_order_relaxed);
+        {
+            std::scoped_lock lk(_receiveQueueMutex);
+            out->queue_bytes = static_cast<u32>(_receiveQueueBytes);
+            slow = slow || (windowMs != 0 && _queueHighSince != 0 &&
+                            os::ConvertToTimeSpan(os::Tick(now - _queueHighSince)).GetMilliSeconds() >= windowMs);
+        }
+        out->slow_consumer = slow ? 1 : 0;
+    }
+
     bool LdnProxySocket::HasError() const {
         std::scoped_lock lk(_errorsMutex);
         return !_errors.empty();
     }
 
     // BSD-compatible wrappers
-    int LdnProxySocket::BsdAccept(sockaddr* addr, socklen_t* addrlen) {
+    int LdnProxySocket::BsdAccept(sockaddr* addr, socklen_t* addrlen, std::shared_ptr<LdnProxySocket>* out_socket) {
         if (!_isListening) {
             errno = EINVAL;
             return -1;
         }
 
-        LdnProxySocket* accepted_socket = nullptr;
-        Accept(&accepted_socket);
-        if (accepted_socket) {
-            // Fill in the address info
-            if (addr && addrlen) {
-                sockaddr_in remote = accepted_socket->GetRemoteEndPoint();
-                size_t copy_size = std::min(static_cast<size_t>(*addrlen), sizeof(sockaddr_in));
-                std::memcpy(addr, &remote, copy_size);
-                *addrlen = sizeof(sockaddr_in);
-            }
-            
-            // Return a fake fd (we'll handle the mapping in BsdMitmService)
-            // For now, just return a positive value to indicate success
-            errno = 0;
-            return 1; // Placeholder, real fd should be assigned by caller
+        std::shared_ptr<LdnProxySocket> accepted_socket = Accept();
+        if (!accepted_socket) {
+            errno = _closed ? ECONNABORTED : EAGAIN;
+            return -1;
         }
-        errno = EAGAIN;
-        return -1;
+
+        // Fill in the address info
+        if (addr && addrlen) {
+            sockaddr_in remote = accepted_socket->GetRemoteEndPoint();
+            size_t copy_size = std::min(static_cast<size_t>(*addrlen), sizeof(sockaddr_in));
+            std::memcpy(addr, &remote, copy_size);
+            *addrlen = sizeof(sockaddr_in);
+        }
+
+        // The caller gives it an fd
+        *out_socket = std::move(accepted_socket);
+        errno = 0;
+        return 0;
     }
 
     int LdnProxySocket::BsdGetSocketOption(int level, int optname, void* optval, socklen_t* optlen) {
-        (void)level; // Unused parameter
-        
         if (!optval || !optlen) {
             errno = EFAULT;
             return -1;
         }
 
+        if (level == IPPROTO_TCP) {
+            if (optname != TcpNoDelay && optname != TcpNoPush) {
+                errno = ENOPROTOOPT;
+                return -1;
+            }
+            if (*optlen < sizeof(s32)) {
+                errno = EINVAL;
+                return -1;
+            }
+            *reinterpret_cast<s32*>(optval) = (optname == TcpNoDelay ? _noDelay : _noPush) ? 1 : 0;
+            *optlen = sizeof(s32);
+            errno = 0;
+            return 0;
+        }
+
         // Map BSD socket options to our SocketOptionName
         SocketOptionName mapped_opt;
         switch (optname) {
@@ -520,7 +1041,20 @@ namespace ams::mitm::ldn::ryuldn::proxy {
                 return -1;
         }
 
-        s32 value = GetSocketOption(mapped_opt);
+        if (mapped_opt == SocketOptionName::ReceiveTimeout || mapped_opt == SocketOptionName::SendTimeout) {
+            if (*optlen < sizeof(BsdTimeVal)) {
+                errno = EINVAL;
+                return -1;
+            }
+            const s64 us = (mapped_opt == SocketOptionName::ReceiveTimeout ? _receiveTimeout : _sendTimeout).GetMicroSeconds();
+            BsdTimeVal tv = { us / 1000000, us % 1000000 };
+            std::memcpy(optval, &tv, sizeof(tv));
+            *optlen = sizeof(tv);
+            errno = 0;
+            return 0;
+        }
+
+        s32 value = mapped_opt == SocketOptionName::Error ? TakeError() : GetSocketOption(mapped_opt);
         
         // Copy to output buffer
         if (*optlen >= sizeof(s32)) {
@@ -535,8 +1069,6 @@ namespace ams::mitm::ldn::ryuldn::proxy {
     }
 
     int LdnProxySocket::BsdSetSocketOption(int level, int optname, const void* optval, socklen_t optlen) {
-        (void)level; // Unused parameter
-        
         if (!optval || optlen < sizeof(s32)) {
             errno = EINVAL;
             return -1;
@@ -544,6 +1076,24 @@ namespace ams::mitm::ldn::ryuldn::proxy {
 
         s32 value = *reinterpret_cast<const s32*>(optval);
 
+        if (level == IPPROTO_TCP) {
+            if (optname == TcpNoDelay) {
+                _noDelay = (value != 0);
+            } else if (optname == TcpNoPush) {
+                _noPush = (value != 0);
+            } else {
+                errno = ENOPROTOOPT;
+                return -1;
+            }
+            // Enabling NODELAY or lifting the cork pushes out whatever was held back
+            if (_noDelay || !_noPush) {
+                FlushCoalesced();
+            }
+            LOG_INFO_ARGS(COMP_RLDN_PROXY_SOC,"LdnProxySocket::BsdSetSocketOption - TCP nodelay=%d nopush=%d", _noDelay, _noPush);
+            errno = 0;
+            return 0;
+        }
+
         // Map BSD socket options to our SocketOptionName
         SocketOptionName mapped_opt;
         switch (optname) {
@@ -560,6 +1110,24 @@ namespace ams::mitm::ldn::ryuldn::proxy {
                 return -1;
         }
 
+        if (mapped_opt == SocketOptionName::ReceiveTimeout || mapped_opt == SocketOptionName::SendTimeout) {
+            // struct timeval, not an int: reading the first word would turn 16ms into "no timeout"
+            if (optlen < sizeof(BsdTimeVal)) {
+                errno = EINVAL;
+                return -1;
+            }
+            BsdTimeVal tv;
+            std::memcpy(&tv, optval, sizeof(tv));
+            if (tv.tv_sec < 0 || tv.tv_usec < 0 || tv.tv_usec >= 1000000) {
+                errno = EDOM;
+                return -1;
+            }
+            SetTimeout(mapped_opt, TimeSpan::FromSeconds(tv.tv_sec) + TimeSpan::FromMicroSeconds(tv.tv_usec));
+            LOG_INFO_ARGS(COMP_RLDN_PROXY_SOC,"LdnProxySocket::BsdSetSocketOption - timeout %d = %lds %ldus", optname, tv.tv_sec, tv.tv_usec);
+            errno = 0;
+            return 0;
+        }
+
         SetSocketOption(mapped_opt, value);
         errno = 0;
         return 0;
@@ -578,18 +1146,19 @@ namespace ams::mitm::ldn::ryuldn::proxy {
     }
 
     int LdnProxySocket::BsdFcntl(int cmd, int flags) {
-        // Handle F_GETFL and F_SETFL for O_NONBLOCK
-        const int F_GETFL = 3;
-        const int F_SETFL = 4;
-        const int O_NONBLOCK = 0x0004;
+        // Handle F_GETFL and F_SETFL for O_NONBLOCK, FreeBSD encodings used by the bsd service
+        // (named apart from the libc macros, which <fcntl.h> defines with other values)
+        constexpr int FcntlGetFl = 3;
+        constexpr int FcntlSetFl = 4;
+        constexpr int FcntlNonBlock = 0x0004;
 
         switch (cmd) {
-            case F_GETFL:
+            case FcntlGetFl:
                 errno = 0;
-                return _blocking ? 0 : O_NONBLOCK;
+                return _blocking ? 0 : FcntlNonBlock;
                 
-            case F_SETFL:
-                _blocking = !(flags & O_NONBLOCK);
+            case FcntlSetFl:
+                _blocking = !(flags & FcntlNonBlock);
                 errno = 0;
                 return 0;
                 
@@ -599,4 +1168,57 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         }
     }
 
+    int LdnProxySocket::BsdIoctl(u32 request, s32* value) {
+        // FreeBSD encodings used by the bsd service
+        constexpr u32 IoctlFionbio = 0x8004667E;    // _IOW('f', 126, int)
+        constexpr u32 IoctlFionread = 0x4004667F;   // _IOR('f', 127, int)
+
+        switch (request) {
+            case IoctlFionread:
+                *value = GetAvailable();
+                errno = 0;
+                return 0;
+
+            case IoctlFionbio:
+                _blocking = (*value == 0);
+                errno = 0;
+                return 0;
+
+            default:
+                errno = ENOTTY;
+                return -1;
+        }
+    }
+
+    int LdnProxySocket::BsdGetSockName(sockaddr* addr, socklen_t* addrlen) {
+        sockaddr_in local = _localEndPoint;
+        if (!_isBound) {
+            // Unbound sockets report the wildcard address
+            std::memset(&local, 0, sizeof(local));
+            local.sin_family = AF_INET;
+        }
+
+        if (addr && addrlen) {
+            std::memcpy(addr, &local, std::min(static_cast<size_t>(*addrlen), sizeof(local)));
+            *addrlen = sizeof(local);
+        }
+        errno = 0;
+        return 0;
+    }
+
+    int LdnProxySocket::BsdGetPeerName(sockaddr* addr, socklen_t* addrlen) {
+        if (!_connected) {
+            errno = ENOTCONN;
+            return -1;
+        }
+
+        if (addr && addrlen) {
+            const sockaddr_in remoteEp = GetRemoteEndPoint();
+            std::memcpy(addr, &remoteEp, std::min(static_cast<size_t>(*addrlen), sizeof(remoteEp)));
+            *addrlen = sizeof(remoteEp);
+        }
+        errno = 0;
+        return 0;
+    }
+
 } // namespace ams::mitm::ldn::ryuldn::proxy
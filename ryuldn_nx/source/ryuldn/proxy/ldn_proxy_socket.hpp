@@ -5,18 +5,22 @@
 // The Ldn server will then route the packets we send (or need to receive) within the virtual adhoc network.
 
 #include "../types.hpp"
+#include "../../ryuldnnx_ipc_types.hpp"
 #include <stratosphere.hpp>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <vector>
 #include <queue>
+#include <deque>
 #include <unordered_map>
 #include <memory>
+#include <atomic>
 
 namespace ams::mitm::ldn::ryuldn::proxy {
 
     // Forward declarations
     class LdnProxy;
+    struct ProxyDatagram;
 
     // WSA Error codes (for BSD socket compatibility)
     enum class WsaError : s32 {
@@ -28,12 +32,22 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         WSAENOTCONN = 10057,
         WSAESHUTDOWN = 10058,
         WSAEMSGSIZE = 10040,
+        WSAECONNRESET = 10054,
     };
 
     // Proxy data packet (wrapper for ProxyDataHeader + data)
+    // The payload is stored once and shared by every socket the packet was routed to (broadcasts);
+    // it is freed when the last queue referencing it consumes the packet
     struct ProxyDataPacket {
         ProxyDataHeaderFull header;
-        std::vector<u8> data;
+        std::shared_ptr<const u8[]> payload;
+        size_t offset;   // Bytes already consumed by partial stream reads
+        size_t size;     // Bytes left to read
+
+        static bool Create(ProxyDataPacket* out, const ProxyDataHeaderFull& header, const u8* const* segments, const size_t* segmentSizes, size_t segmentCount);
+
+        const u8* Data() const { return payload.get() + offset; }
+        size_t Size() const { return size; }
     };
 
     // Socket option names (subset of BSD socket options)
@@ -55,17 +69,28 @@ namespace ams::mitm::ldn::ryuldn::proxy {
     // LDN Proxy Socket Implementation
     class LdnProxySocket {
     private:
+        static constexpr size_t DefaultReceiveBufferSize = 131072;
+        static constexpr size_t MinReceiveBufferSize = 2048;
+        static constexpr size_t MaxReceiveBufferSize = 1024 * 1024;
+        static constexpr size_t StreamReceiveSlack = 4;
+        static constexpr s32 MaxBacklog = 128;   // SOMAXCONN
+
+        // Small stream writes are merged into one ProxyData frame until this many bytes are pending
+        static constexpr size_t CoalesceThreshold = 1400;
+        // IPPROTO_TCP level options (TCP_NODELAY collides with SO_DEBUG, so they are not in _socketOptions)
+        static constexpr int TcpNoDelay = 0x01;
+        static constexpr int TcpNoPush = 0x04;
+
         LdnProxy* _proxy;
 
         bool _isListening;
-        std::vector<LdnProxySocket*> _listenSockets;
-        os::Mutex _listenSocketsMutex;
-
-        std::queue<ProxyConnectRequestFull> _connectRequests;
-        mutable os::Mutex _connectRequestsMutex;
+        s32 _backlog;
+        // Connections already answered (ProxyConnectReply sent) and waiting for accept()
+        std::deque<std::shared_ptr<LdnProxySocket>> _acceptQueue;
+        mutable os::Mutex _acceptQueueMutex;
+        std::atomic<u32> _backlogDrops;   // Bumped under _acceptQueueMutex, read without it
 
         os::SystemEvent _acceptEvent;
-        s32 _acceptTimeout;
 
         std::queue<s32> _errors;
         mutable os::Mutex _errorsMutex;
@@ -73,12 +98,30 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         os::SystemEvent _connectEvent;
         ProxyConnectResponseFull _connectResponse;
 
-        s32 _receiveTimeout;
+        // SO_RCVTIMEO (receive, accept) and SO_SNDTIMEO (connect); zero waits forever
+        TimeSpan _receiveTimeout;
+        TimeSpan _sendTimeout;
         os::SystemEvent _receiveEvent;
         std::queue<ProxyDataPacket> _receiveQueue;
+        size_t _receiveQueueBytes;   // Payload bytes in _receiveQueue, kept for GetAvailable
+        size_t _receiveBufferSize;   // SO_RCVBUF, bounds _receiveQueueBytes
+        bool _receiveOverflowed;     // Stream data was dropped; the connection is reset once drained
+        std::atomic<u32> _receiveDrops;   // Bumped under _receiveQueueMutex, read without it
+        s64 _queueHighSince;         // Tick the queue went over half its limit, 0 while below
         mutable os::Mutex _receiveQueueMutex;
 
-        bool _connecting;
+        // Traffic counters, read by GetStats without the socket's locks
+        std::atomic<u64> _packetsIn;
+        std::atomic<u64> _bytesIn;
+        std::atomic<u64> _packetsOut;
+        std::atomic<u64> _bytesOut;
+        std::atomic<u32> _queueHighWater;
+        std::atomic<s64> _lastReadTick;   // 0 = never read
+        std::atomic<bool> _slowConsumer;  // Latched until the socket is reopened
+
+        // Connect state is written by the master worker (connect reply) while game threads send
+        std::atomic<bool> _connecting;       // Waiting for ProxyConnectReply (also set with _connected during an optimistic connect)
+        std::atomic<bool> _connectRefused;   // The peer refused the connect; reported by later sends/receives
         bool _broadcast;
         bool _readShutdown;
         bool _writeShutdown;
@@ -89,7 +132,14 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         sockaddr_in _remoteEndPoint;
         sockaddr_in _localEndPoint;
 
-        bool _connected;
+        // Routing info toward _remoteEndPoint, built once when the socket becomes connected
+        ProxyInfo _connectedInfo;
+        // Guards _remoteEndPoint and _connectedInfo: an optimistic connect's reply rewrites them on the
+        // worker while game threads send. Only held to copy them, never across a call
+        mutable os::SdkMutex _peerMutex;
+
+        std::atomic<bool> _connected;
+        u16 _acceptedFromPort;   // Listen port of the listener that accepted us, 0 otherwise
         bool _isBound;
 
         s32 _addressFamily;  // AF_INET
@@ -98,27 +148,55 @@ namespace ams::mitm::ldn::ryuldn::proxy {
 
         bool _blocking;
 
+        bool _noDelay;   // TCP_NODELAY: every write is sent right away
+        bool _noPush;    // TCP_NOPUSH: hold writes until a full frame, the option is cleared or the socket closes
+        std::vector<u8> _coalesceBuffer;
+        os::Mutex _coalesceMutex;
+
         // Helper methods
         sockaddr_in EnsureLocalEndpoint(bool replace);
         sockaddr_in GetEndpoint(u32 ipv4, u16 port);
         void SignalError(WsaError error);
+        void SetConnected(const sockaddr_in& remoteEp);
+        void SetTimeout(SocketOptionName optionName, TimeSpan timeout);
+        // Pops the oldest pending error as an errno value, 0 if none (SO_ERROR)
+        s32 TakeError();
+        // Pops (or peeks) the front packet; caller holds _receiveQueueMutex and the queue is not empty
+        s32 DequeueLocked(u8* buffer, size_t bufferSize, s32 flags, sockaddr_in* outSrcAddr);
+        // Caller holds _receiveQueueMutex
+        size_t ReceiveLimitLocked() const;
+        void TrackQueueDepthLocked();
+        s32 CountSent(s32 result, size_t packets = 1);
 
     public:
+        LdnProxySocket();   // Closed and unregistered, for LdnProxySocketPool
         LdnProxySocket(s32 addressFamily, s32 socketType, s32 protocolType, LdnProxy* proxy);
         ~LdnProxySocket();
 
+        // (Re)open a closed socket: resets all state and registers it with the proxy
+        void Open(s32 addressFamily, s32 socketType, s32 protocolType, LdnProxy* proxy);
+
         // Socket operations
-        void Accept(LdnProxySocket** out_socket);
+        // Takes the oldest established connection; nullptr if none (nonblocking, timeout, closed)
+        std::shared_ptr<LdnProxySocket> Accept();
         void Bind(const sockaddr_in* localEP);
         void Close();
-        void Connect(const sockaddr_in* remoteEP);
+        // 0 or -1 with errno. An optimistic TCP connect does not wait for the peer's reply: the socket
+        // is usable at once and writes follow the ProxyConnect frame on the relay
+        s32 Connect(const sockaddr_in* remoteEP, bool optimistic = false);
         void Disconnect(bool reuseSocket);
         void Listen(s32 backlog);
 
+        // Return -1 with errno set on failure
         s32 Receive(u8* buffer, size_t bufferSize, s32 flags);
-        s32 ReceiveFrom(u8* buffer, size_t bufferSize, s32 flags, sockaddr_in* outSrcAddr);
+        // A callTimeout (recvmmsg's timeval) bounds the wait when it is tighter than SO_RCVTIMEO
+        s32 ReceiveFrom(u8* buffer, size_t bufferSize, s32 flags, sockaddr_in* outSrcAddr,
+                        TimeSpan callTimeout = TimeSpan::FromNanoSeconds(0));
         s32 Send(const u8* buffer, size_t bufferSize, s32 flags);
         s32 SendTo(const u8* buffer, size_t bufferSize, s32 flags, const sockaddr_in* destAddr);
+        s32 SendToBatch(const ProxyDatagram* datagrams, size_t count);
+        // Sends stream writes held back by Nagle coalescing (called by LdnProxy's flush timer)
+        void FlushCoalesced();
 
         void Shutdown(s32 how);
 
@@ -127,27 +205,50 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         void SetSocketOption(SocketOptionName optionName, s32 optionValue);
 
         // Packet handling (called by LdnProxy)
-        void IncomingData(const ProxyDataPacket& packet);
+        // Returns true if the packet was queued; with signal=false the caller wakes readers via SignalReceive
+        bool IncomingData(const ProxyDataPacket& packet, bool signal = true);
+        void SignalReceive() { _receiveEvent.Signal(); }
         void IncomingConnectionRequest(const ProxyConnectRequestFull& request);
         void HandleConnectResponse(const ProxyConnectResponseFull& response);
         void HandleDisconnect(const ProxyDisconnectMessageFull& msg);
 
         // BSD-compatible wrappers (return -1 on error, set errno)
-        int BsdAccept(sockaddr* addr, socklen_t* addrlen);
+        int BsdAccept(sockaddr* addr, socklen_t* addrlen, std::shared_ptr<LdnProxySocket>* out_socket);
         int BsdGetSocketOption(int level, int optname, void* optval, socklen_t* optlen);
         int BsdSetSocketOption(int level, int optname, const void* optval, socklen_t optlen);
         int BsdListen(int backlog);
         int BsdShutdown(int how);
         int BsdFcntl(int cmd, int flags);
+        int BsdIoctl(u32 request, s32* value);
+        int BsdGetSockName(sockaddr* addr, socklen_t* addrlen);
+        int BsdGetPeerName(sockaddr* addr, socklen_t* addrlen);
 
         // Properties
         bool IsConnected() const { return _connected; }
+        // An optimistic connector writes to this port until the connect reply tells it ours
+        u16 GetAcceptedFromPort() const { return _acceptedFromPort; }
+        // False for traffic from anyone but the peer of a connected socket
+        // (an optimistic connect still has to hear the reply, which may be a refusal from no particular port)
+        bool IsRoutedFrom(const ProxyInfo& info) const {
+            if (!_connected || _connecting) {
+                return true;
+            }
+            const ProxyInfo peer = GetConnectedInfo();
+            return info.sourcePort == peer.destPort && (info.sourceIpV4 == 0 || info.sourceIpV4 == peer.destIpV4);
+        }
         bool IsBound() const { return _isBound; }
         bool IsListening() const { return _isListening; }
         bool IsBlocking() const { return _blocking; }
         void SetBlocking(bool blocking) { _blocking = blocking; }
 
-        const sockaddr_in& GetRemoteEndPoint() const { return _remoteEndPoint; }
+        sockaddr_in GetRemoteEndPoint() const {
+            std::scoped_lock lk(_peerMutex);
+            return _remoteEndPoint;
+        }
+        ProxyInfo GetConnectedInfo() const {
+            std::scoped_lock lk(_peerMutex);
+            return _connectedInfo;
+        }
         const sockaddr_in& GetLocalEndPoint() const { return _localEndPoint; }
 
         s32 GetAddressFamily() const { return _addressFamily; }
@@ -159,9 +260,12 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         bool IsReadable() const;
         bool IsWritable() const;
         bool HasError() const;
+        u32 GetReceiveDrops() const { return _receiveDrops.load(std::memory_order_relaxed); }
+        u32 GetBacklogDrops() const { return _backlogDrops.load(std::memory_order_relaxed); }
+        void GetStats(RyuLdnSocketStats* out) const;
 
         // Internal helper for accepted sockets
-        LdnProxySocket* AsAccepted(const sockaddr_in& remoteEp);
+        LdnProxySocket* AsAccepted(const sockaddr_in& remoteEp, u16 listenPort);
     };
 
 } // namespace ams::mitm::ldn::ryuldn::proxy
@@ -0,0 +1,80 @@
+#include "ldn_proxy_socket_pool.hpp"
+#include "../../debug.hpp"
+
+#include <algorithm>
+
+namespace ams::mitm::ldn::ryuldn::proxy {
+
+    LdnProxySocketPool::LdnProxySocketPool()
+        : _idle{},
+          _idleCount(0),
+          _capacity(0),
+          _mutex(false),
+          _misses(0) {}
+
+    LdnProxySocketPool::~LdnProxySocketPool() {
+        std::scoped_lock lk(_mutex);
+        for (size_t i = 0; i < _idleCount; i++) {
+            delete _idle[i];
+        }
+        _idleCount = 0;
+    }
+
+    void LdnProxySocketPool::Prefill(size_t capacity) {
+        std::scoped_lock lk(_mutex);
+        _capacity = std::min(capacity, MaxPoolSize);
+
+        while (_idleCount > _capacity) {
+            delete _idle[--_idleCount];
+        }
+        while (_idleCount < _capacity) {
+            LdnProxySocket* socket = new (std::nothrow) LdnProxySocket();
+            if (socket == nullptr) {
+                LOG_WARN_ARGS(COMP_RLDN_PROXY_SOC,"LdnProxySocketPool: prefill stopped at %zu sockets (out of memory)", _idleCount);
+                break;
+            }
+            _idle[_idleCount++] = socket;
+        }
+
+        LOG_INFO_ARGS(COMP_RLDN_PROXY_SOC,"LdnProxySocketPool: %zu idle sockets", _idleCount);
+    }
+
+    std::shared_ptr<LdnProxySocket> LdnProxySocketPool::Acquire(s32 addressFamily, s32 socketType, s32 protocolType, LdnProxy* proxy) {
+        LdnProxySocket* socket = nullptr;
+        {
+            std::scoped_lock lk(_mutex);
+            if (_idleCount > 0) {
+                socket = _idle[--_idleCount];
+            }
+        }
+
+        if (socket == nullptr) {
+            const u32 misses = ++_misses;
+            LOG_DBG_ARGS(COMP_RLDN_PROXY_SOC,"LdnProxySocketPool: miss #%u, allocating", misses);
+            socket = new (std::nothrow) LdnProxySocket();
+            if (socket == nullptr) {
+                LOG_ERR(COMP_RLDN_PROXY_SOC,"LdnProxySocketPool: failed to allocate LdnProxySocket - out of memory");
+                return nullptr;
+            }
+        }
+
+        socket->Open(addressFamily, socketType, protocolType, proxy);
+        return std::shared_ptr<LdnProxySocket>(socket, [this](LdnProxySocket* released) { Release(released); });
+    }
+
+    void LdnProxySocketPool::Release(LdnProxySocket* socket) {
+        // No-op if the owner already closed it
+        socket->Close();
+
+        {
+            std::scoped_lock lk(_mutex);
+            if (_idleCount < _capacity) {
+                _idle[_idleCount++] = socket;
+                return;
+            }
+        }
+
+        delete socket;
+    }
+
+} // namespace ams::mitm::ldn::ryuldn::proxy
@@ -0,0 +1,51 @@
+#pragma once
+// LDN Proxy Socket Pool
+// Keeps closed LdnProxySocket objects around so their events and containers are reused
+
+#include "ldn_proxy_socket.hpp"
+#include <stratosphere.hpp>
+#include <atomic>
+#include <memory>
+
+namespace ams::mitm::ldn::ryuldn::proxy {
+
+    /**
+     * Bounded pool of idle virtual sockets
+     *
+     * - Prefill() constructs up to the configured number of idle sockets ahead of time
+     * - Acquire() reopens an idle socket, or allocates a new one when the pool is empty (a miss)
+     * - The returned handle hands the socket back on release; sockets beyond capacity are freed
+     *
+     * The pool must outlive every handle it returned.
+     */
+    class LdnProxySocketPool {
+    public:
+        static constexpr size_t MaxPoolSize = 32;
+
+    private:
+        LdnProxySocket* _idle[MaxPoolSize];
+        size_t _idleCount;
+        size_t _capacity;
+        os::Mutex _mutex;
+        std::atomic<u32> _misses;
+
+        void Release(LdnProxySocket* socket);
+
+    public:
+        LdnProxySocketPool();
+        ~LdnProxySocketPool();
+
+        // No copy/move
+        LdnProxySocketPool(const LdnProxySocketPool&) = delete;
+        LdnProxySocketPool& operator=(const LdnProxySocketPool&) = delete;
+
+        // Set the number of idle sockets kept (clamped to MaxPoolSize) and construct them
+        void Prefill(size_t capacity);
+
+        // Returns nullptr only if a miss could not be allocated
+        std::shared_ptr<LdnProxySocket> Acquire(s32 addressFamily, s32 socketType, s32 protocolType, LdnProxy* proxy);
+
+        u32 GetMissCount() const { return _misses.load(std::memory_order_relaxed); }
+    };
+
+} // namespace ams::mitm::ldn::ryuldn::proxy
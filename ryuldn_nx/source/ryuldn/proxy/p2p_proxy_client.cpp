@@ -5,6 +5,8 @@
 #include <arpa/inet.h>
 #include <cstring>
 #include <netinet/tcp.h>
+#include <fcntl.h>
+#include <poll.h>
 
 namespace ams::mitm::ldn::ryuldn::proxy {
 
@@ -15,6 +17,8 @@ namespace ams::mitm::ldn::ryuldn::proxy {
           _connected(false),
           _ready(false),
           _running(false),
+          _authPending(false),
+          _failed(false),
           _protocol(g_sharedBufferPool),  // Use shared BufferPool
           _receiveThread{},  // Zero-initialize thread structure
           _connectedEvent(os::EventClearMode_ManualClear, true),
@@ -37,11 +41,7 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         Disconnect();
     }
 
-    bool P2pProxyClient::Connect() {
-        if (_connected) {
-            return true;
-        }
-
+    bool P2pProxyClient::CreateSocket() {
         // Create socket
         _socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
         if (_socket < 0) {
@@ -52,7 +52,10 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         // Set TCP_NODELAY if supported
         int optval = 1;
         setsockopt(_socket, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval));
+        return true;
+    }
 
+    bool P2pProxyClient::ConnectSocket() {
         // Connect to server
         sockaddr_in serverAddr;
         std::memset(&serverAddr, 0, sizeof(serverAddr));
@@ -61,25 +64,56 @@ namespace ams::mitm::ldn::ryuldn::proxy {
 
         if (inet_pton(AF_INET, _address.c_str(), &serverAddr.sin_addr) <= 0) {
             LOG_INFO_ARGS(COMP_RLDN_P2P_CLI, "P2pProxyClient: Invalid address %s", _address.c_str());
-            close(_socket);
-            _socket = -1;
             return false;
         }
 
-        if (connect(_socket, reinterpret_cast<sockaddr*>(&serverAddr), sizeof(serverAddr)) < 0) {
+        // Non-blocking connect bounded by FailureTimeoutMs (an unreachable host would otherwise block for the OS TCP timeout)
+        int flags = fcntl(_socket, F_GETFL, 0);
+        fcntl(_socket, F_SETFL, flags | O_NONBLOCK);
+
+        int rc = connect(_socket, reinterpret_cast<sockaddr*>(&serverAddr), sizeof(serverAddr));
+        if (rc < 0 && errno != EINPROGRESS) {
             LOG_INFO_ARGS(COMP_RLDN_P2P_CLI, "P2pProxyClient: Failed to connect to %s:%u (errno=%d)", _address.c_str(), _port, errno);
-            close(_socket);
-            _socket = -1;
             return false;
         }
 
+        if (rc < 0) {
+            // The wake socket is only open for a background join, Disconnect signals it
+            struct pollfd pfds[2] = {
+                {_socket, POLLOUT, 0},
+                {_wakeSocket.GetFd(), POLLIN, 0},
+            };
+            int pollRet = poll(pfds, _wakeSocket.IsOpen() ? 2 : 1, FailureTimeoutMs);
+            if (pollRet > 0 && (pfds[1].revents & POLLIN)) {
+                LOG_INFO_ARGS(COMP_RLDN_P2P_CLI, "P2pProxyClient: Connect to %s:%u cancelled", _address.c_str(), _port);
+                return false;
+            }
+            if (pollRet <= 0) {
+                LOG_INFO_ARGS(COMP_RLDN_P2P_CLI, "P2pProxyClient: Connect to %s:%u %s (errno=%d)", _address.c_str(), _port,
+                         pollRet == 0 ? "timed out" : "failed", errno);
+                return false;
+            }
+
+            int error = 0;
+            socklen_t len = sizeof(error);
+            getsockopt(_socket, SOL_SOCKET, SO_ERROR, &error, &len);
+            if (error != 0) {
+                LOG_INFO_ARGS(COMP_RLDN_P2P_CLI, "P2pProxyClient: Failed to connect to %s:%u (error=%d)", _address.c_str(), _port, error);
+                return false;
+            }
+        }
+
+        // Back to blocking mode for the receive loop
+        fcntl(_socket, F_SETFL, flags & ~O_NONBLOCK);
+        return true;
+    }
+
+    bool P2pProxyClient::StartReceiveThread() {
         // Allocate thread stack with explicit nothrow allocation
         _threadStack.reset(new (std::nothrow) u8[ThreadStackSize + os::ThreadStackAlignment]);
         
         if (!_threadStack) {
             LOG_INFO(COMP_RLDN_P2P_CLI, "P2pProxyClient: Failed to allocate thread stack");
-            close(_socket);
-            _socket = -1;
             return false;
         }
         
@@ -101,25 +135,101 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         if (R_FAILED(rc)) {
             LOG_INFO(COMP_RLDN_P2P_CLI, "[THREAD-DIAG] !!! RECEIVE THREAD CREATION FAILED (CLIENT) !!!");
             LOG_INFO_ARGS(COMP_RLDN_P2P_CLI, "[THREAD-DIAG]   Error code: 0x%x", rc.GetValue());
+            return false;
+        }
+
+        _running = true;
+        os::StartThread(&_receiveThread);
+        return true;
+    }
+
+    bool P2pProxyClient::Connect() {
+        if (_connected) {
+            return true;
+        }
+
+        if (!CreateSocket()) {
+            return false;
+        }
+
+        if (!ConnectSocket()) {
             close(_socket);
             _socket = -1;
             return false;
         }
 
         _connected = true;
-        _running = true;
         os::SignalSystemEvent(_connectedEvent.GetBase());
-        os::StartThread(&_receiveThread);
+
+        if (!StartReceiveThread()) {
+            _connected = false;
+            os::ClearSystemEvent(_connectedEvent.GetBase());
+            close(_socket);
+            _socket = -1;
+            return false;
+        }
 
         LOG_INFO_ARGS(COMP_RLDN_P2P_CLI, "P2pProxyClient: Connected to %s:%u", _address.c_str(), _port);
         return true;
     }
 
+    bool P2pProxyClient::ConnectAsync(const ExternalProxyConfig& config) {
+        if (_connected || _running) {
+            return false;
+        }
+
+        if (!CreateSocket()) {
+            return false;
+        }
+
+        // Connect + auth run on the receive thread, the caller returns immediately
+        _pendingAuth = config;
+        _authPending = true;
+        _failed = false;
+
+        if (!_wakeSocket.Open()) {
+            LOG_WARN(COMP_RLDN_P2P_CLI, "P2pProxyClient: No wake socket, disconnecting may wait for the connect timeout");
+        }
+
+        if (!StartReceiveThread()) {
+            _authPending = false;
+            _wakeSocket.Close();
+            close(_socket);
+            _socket = -1;
+            return false;
+        }
+
+        LOG_INFO_ARGS(COMP_RLDN_P2P_CLI, "P2pProxyClient: Connecting to %s:%u in background", _address.c_str(), _port);
+        return true;
+    }
+
+    bool P2pProxyClient::CompletePendingAuth() {
+        _authPending = false;
+
+        if (!ConnectSocket()) {
+            return false;
+        }
+
+        {
+            std::scoped_lock lk(_stateMutex);
+            if (!_running) {
+                return false;
+            }
+            _connected = true;
+            os::SignalSystemEvent(_connectedEvent.GetBase());
+        }
+
+        LOG_INFO_ARGS(COMP_RLDN_P2P_CLI, "P2pProxyClient: Connected to %s:%u", _address.c_str(), _port);
+        // Connected right here, so PerformAuth's wait (which Disconnect could stretch to the timeout) is skipped
+        return SendAuth(_pendingAuth);
+    }
+
     void P2pProxyClient::Disconnect() {
         if (!_connected && !_running) {
             return;
         }
 
+        const bool threadStarted = _running;
         _running = false;
         _connected = false;
         _ready = false;
@@ -127,17 +237,19 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         os::ClearSystemEvent(_connectedEvent.GetBase());
         os::ClearSystemEvent(_readyEvent.GetBase());
 
-        // Shutdown socket to wake up receive thread
+        // Shutdown socket to wake up receive thread; a connect still in progress is woken by the wake socket
         if (_socket >= 0) {
             shutdown(_socket, SHUT_RDWR);
         }
+        _wakeSocket.Signal();
 
         // Wait for receive thread
-        if (_running) {
+        if (threadStarted) {
             os::WaitThread(&_receiveThread);
             os::DestroyThread(&_receiveThread);
             std::memset(&_receiveThread, 0, sizeof(_receiveThread));
         }
+        _wakeSocket.Close();
 
         // Close socket
         if (_socket >= 0) {
@@ -156,7 +268,14 @@ namespace ams::mitm::ldn::ryuldn::proxy {
     void P2pProxyClient::ReceiveLoop() {
         u8 buffer[ReceiveBufferSize];
 
-        while (_running) {
+        if (_authPending && !CompletePendingAuth()) {
+            if (_running) {
+                LOG_WARN_ARGS(COMP_RLDN_P2P_CLI, "P2pProxyClient: P2P join to %s:%u failed, staying on server relay", _address.c_str(), _port);
+            }
+            _failed = true;
+        }
+
+        while (_running && !_failed) {
             ssize_t received = recv(_socket, buffer, sizeof(buffer), 0);
 
             if (received > 0) {
@@ -196,9 +315,8 @@ namespace ams::mitm::ldn::ryuldn::proxy {
     }
 
     bool P2pProxyClient::PerformAuth(const ExternalProxyConfig& config) {
-        // Wait for connection
+        // Wait for connection (signaled by Connect(), so it must not be cleared here)
         TimeSpan timeout = TimeSpan::FromMilliSeconds(FailureTimeoutMs);
-        os::ClearSystemEvent(_connectedEvent.GetBase());
         if (!os::TimedWaitSystemEvent(_connectedEvent.GetBase(), timeout)) {
             LOG_INFO(COMP_RLDN_P2P_CLI, "P2pProxyClient: Connection timeout");
             return false;
@@ -209,6 +327,10 @@ namespace ams::mitm::ldn::ryuldn::proxy {
             return false;
         }
 
+        return SendAuth(config);
+    }
+
+    bool P2pProxyClient::SendAuth(const ExternalProxyConfig& config) {
         // Send authentication
         ScopedBuffer buffer(g_sharedBufferPool);
         if (!buffer.Get()) {
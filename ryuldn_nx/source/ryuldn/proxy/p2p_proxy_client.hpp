@@ -6,10 +6,12 @@
 #include "../types.hpp"
 #include "../ryu_ldn_protocol.hpp"
 #include "../buffer_pool.hpp"
+#include "../wake_socket.hpp"
 #include <stratosphere.hpp>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <string>
+#include <atomic>
 
 namespace ams::mitm::ldn::ryuldn::proxy {
 
@@ -28,6 +30,12 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         bool _ready;
         bool _running;
 
+        // Background join (ConnectAsync): connect + auth done on the receive thread
+        ExternalProxyConfig _pendingAuth;
+        bool _authPending;
+        std::atomic<bool> _failed;   // Set by the receive thread, read by the master client worker
+        WakeSocket _wakeSocket;      // Lets Disconnect interrupt the background connect's poll()
+
         ProxyConfig _proxyConfig;
         
         // Use protocol with shared BufferPool
@@ -51,6 +59,13 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         static void ReceiveThreadFunc(void* arg);
         void ReceiveLoop();
 
+        // Connection helpers
+        bool CreateSocket();
+        bool ConnectSocket();
+        bool StartReceiveThread();
+        bool CompletePendingAuth();
+        bool SendAuth(const ExternalProxyConfig& config);
+
     public:
         P2pProxyClient(const std::string& address, u16 port);
         ~P2pProxyClient();
@@ -58,6 +73,10 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         // Connect to server
         bool Connect();
 
+        // Connect and authenticate on the receive thread (bounded by FailureTimeoutMs)
+        // Returns false only if the thread could not be started
+        bool ConnectAsync(const ExternalProxyConfig& config);
+
         // Disconnect from server
         void Disconnect();
 
@@ -73,6 +92,8 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         // Accessors
         bool IsConnected() const { return _connected; }
         bool IsReady() const { return _ready; }
+        // The background join gave up; the client is idle and can be freed
+        bool HasFailed() const { return _failed.load(); }
         const ProxyConfig& GetProxyConfig() const { return _proxyConfig; }
         RyuLdnProtocol* GetProtocol() { return &_protocol; }
     };
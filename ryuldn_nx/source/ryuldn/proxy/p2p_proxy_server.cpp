@@ -2,6 +2,7 @@
 #include "../ldn_master_proxy_client.hpp"
 #include "../../debug.hpp"
 #include <unistd.h>
+#include <poll.h>
 #include <arpa/inet.h>
 #include <cstring>
 #include <algorithm>
@@ -23,6 +24,7 @@ namespace ams::mitm::ldn::ryuldn::proxy {
           _tokenEvent(os::EventClearMode_ManualClear, true),
           _leaseThread{},  // Zero-initialize thread structures
           _leaseThreadRunning(false),
+          _leaseStopEvent(os::EventClearMode_ManualClear, false),
           _acceptThread{},  // Zero-initialize thread structures
           _sessionPool(this),  // Initialize session pool
           _playersLock(false)
@@ -84,6 +86,10 @@ namespace ams::mitm::ldn::ryuldn::proxy {
             return false;
         }
 
+        if (!_acceptWake.Open()) {
+            LOG_WARN_ARGS(COMP_RLDN_P2P_SRV, "P2pProxyServer: Failed to open accept wake socket (errno=%d), relying on shutdown()", errno);
+        }
+
         // Allocate accept thread stack with explicit nothrow allocation
         LOG_HEAP(COMP_RLDN_P2P_SRV, "before P2pProxyServer accept thread stack");
         _acceptThreadStack.reset(new (std::nothrow) u8[AcceptThreadStackSize + os::ThreadStackAlignment]);
@@ -135,33 +141,44 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         }
 
         LOG_INFO(COMP_RLDN_P2P_SRV, "[THREAD-DIAG] Stopping P2P Server threads...");
+        const os::Tick start = os::GetSystemTick();
         _running = false;
 
-        // Close listen socket to wake up accept thread
+        // Signal every loop first so they all wind down in parallel...
+        _acceptWake.Signal();
         if (_listenSocket >= 0) {
             shutdown(_listenSocket, SHUT_RDWR);
-            close(_listenSocket);
-            _listenSocket = -1;
         }
+        if (_leaseThreadRunning) {
+            _leaseThreadRunning = false;
+            _leaseStopEvent.Signal();
+        }
+        _sessionPool.SignalStopAll();
 
-        // Wait for accept thread
+        // ...then join them
         os::WaitThread(&_acceptThread);
         os::DestroyThread(&_acceptThread);
         std::memset(&_acceptThread, 0, sizeof(_acceptThread));
 
+        if (_listenSocket >= 0) {
+            close(_listenSocket);
+            _listenSocket = -1;
+        }
+        _acceptWake.Close();
+
         // Stop all sessions via pool
         _sessionPool.Clear();
         _players.clear();
 
         // Stop lease renewal thread
-        if (_leaseThreadRunning) {
-            _leaseThreadRunning = false;
+        if (_leaseThreadStack) {
             os::WaitThread(&_leaseThread);
             os::DestroyThread(&_leaseThread);
             std::memset(&_leaseThread, 0, sizeof(_leaseThread));
+            _leaseThreadStack.reset();
         }
 
-        LOG_INFO(COMP_RLDN_P2P_SRV, "P2pProxyServer: Stopped");
+        LOG_INFO_ARGS(COMP_RLDN_P2P_SRV, "P2pProxyServer: Stopped in %ldms", (os::GetSystemTick() - start).ToTimeSpan().GetMilliSeconds());
     }
 
     void P2pProxyServer::Dispose() {
@@ -234,7 +251,10 @@ namespace ams::mitm::ldn::ryuldn::proxy {
                     Result rc = os::CreateThread(&_leaseThread, LeaseRenewalThreadFunc, this, leaseStackTop, LeaseThreadStackSize, 0x2C, 3);
                     if (R_SUCCEEDED(rc)) {
                         _leaseThreadRunning = true;
+                        _leaseStopEvent.Clear();
                         os::StartThread(&_leaseThread);
+                    } else {
+                        _leaseThreadStack.reset();
                     }
                 }
 
@@ -263,6 +283,25 @@ namespace ams::mitm::ldn::ryuldn::proxy {
 
     void P2pProxyServer::AcceptLoop() {
         while (_running) {
+            // Wait for a client or a Stop() wakeup
+            struct pollfd pfds[2] = {
+                {_listenSocket, POLLIN, 0},
+                {_acceptWake.GetFd(), POLLIN, 0},
+            };
+            int pollRet = ::poll(pfds, _acceptWake.IsOpen() ? 2 : 1, -1);
+            if (pollRet < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (_running) {
+                    LOG_INFO_ARGS(COMP_RLDN_P2P_SRV, "P2pProxyServer: Accept poll error: %d", errno);
+                }
+                break;
+            }
+            if (!_running || (pfds[1].revents & POLLIN)) {
+                break;
+            }
+
             sockaddr_in clientAddr;
             socklen_t clientAddrLen = sizeof(clientAddr);
 
@@ -305,8 +344,10 @@ namespace ams::mitm::ldn::ryuldn::proxy {
 
     void P2pProxyServer::LeaseRenewalLoop() {
         while (_leaseThreadRunning && !_disposed) {
-            // Wait for renewal interval
-            os::SleepThread(TimeSpan::FromSeconds(PortLeaseRenew));
+            // Wait for renewal interval (returns early when Stop() signals)
+            if (_leaseStopEvent.TimedWait(TimeSpan::FromSeconds(PortLeaseRenew))) {
+                break;
+            }
 
             if (!_leaseThreadRunning || _disposed) {
                 break;
@@ -9,6 +9,7 @@
 #include "p2p_proxy_session.hpp"
 #include "upnp_client.hpp"
 #include "../session_pool.hpp"
+#include "../wake_socket.hpp"
 #include <stratosphere.hpp>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -65,12 +66,14 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         os::ThreadType _leaseThread;
         std::unique_ptr<u8[]> _leaseThreadStack;
         bool _leaseThreadRunning;
+        os::SystemEvent _leaseStopEvent;  // Ends the renewal wait immediately on Stop()
         static constexpr size_t LeaseThreadStackSize = 0x4000;  // 16KB (increased from 12KB for stability)
 
         // Accept thread
         os::ThreadType _acceptThread;
         std::unique_ptr<u8[]> _acceptThreadStack;
         static constexpr size_t AcceptThreadStackSize = 0x4000;  // 16KB (increased from 12KB for stability)
+        WakeSocket _acceptWake;  // Wakes AcceptLoop out of poll() on Stop()
 
         // Session management with pool for reuse
         SessionPool _sessionPool;
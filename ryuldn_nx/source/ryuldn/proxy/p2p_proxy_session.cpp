@@ -12,6 +12,7 @@ namespace ams::mitm::ldn::ryuldn::proxy {
           _virtualIpAddress(0),
           _masterClosed(false),
           _running(false),
+          _stopping(false),
           _protocol(g_sharedBufferPool),  // Use shared BufferPool
           _receiveThread{},  // Zero-initialize thread structure
           _sendMutex(false)
@@ -101,6 +102,7 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         }
 
         _running = true;
+        _stopping = false;
         os::StartThread(&_receiveThread);
 
         LOG_INFO(COMP_RLDN_P2P_SES, "P2pProxySession: Started");
@@ -112,20 +114,34 @@ namespace ams::mitm::ldn::ryuldn::proxy {
             return;
         }
 
-        _running = false;
+        SignalStop();
 
-        // Shutdown socket to wake up receive thread
-        if (_socket >= 0) {
-            shutdown(_socket, SHUT_RDWR);
+        // Called from our own receive thread (e.g. failed auth): it exits on its own
+        if (os::GetCurrentThread() == &_receiveThread) {
+            return;
         }
 
         os::WaitThread(&_receiveThread);
         os::DestroyThread(&_receiveThread);
         std::memset(&_receiveThread, 0, sizeof(_receiveThread));
+        _running = false;
 
         LOG_INFO(COMP_RLDN_P2P_SES, "P2pProxySession: Stopped");
     }
 
+    void P2pProxySession::SignalStop() {
+        if (_stopping) {
+            return;
+        }
+        _stopping = true;
+        _masterClosed = true;
+
+        // Shutdown socket to wake up receive thread
+        if (_socket >= 0) {
+            shutdown(_socket, SHUT_RDWR);
+        }
+    }
+
     void P2pProxySession::DisconnectAndStop() {
         _masterClosed = true;
         Stop();
@@ -140,7 +156,7 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         u8* buffer = _receiveBuffer.get();
         constexpr size_t bufferSize = 8192;
 
-        while (_running) {
+        while (!_stopping) {
             ssize_t received = recv(_socket, buffer, bufferSize, 0);
 
             if (received > 0) {
@@ -171,6 +187,7 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         _virtualIpAddress = 0;
         _masterClosed = false;
         _running = false;
+        _stopping = false;
         
         // Reset protocol state
         _protocol.Reset();
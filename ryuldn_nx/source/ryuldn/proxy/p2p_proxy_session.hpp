@@ -19,7 +19,8 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         s32 _socket;
         u32 _virtualIpAddress;
         bool _masterClosed;
-        bool _running;
+        bool _running;   // Receive thread exists and must be joined
+        bool _stopping;  // Receive thread asked to exit
 
         // Use protocol with shared BufferPool (no permanent buffer)
         RyuLdnProtocol _protocol;
@@ -54,6 +55,9 @@ namespace ams::mitm::ldn::ryuldn::proxy {
         // Stop session
         void Stop();
 
+        // Wake the receive thread without joining it (server-initiated, no callback to parent)
+        void SignalStop();
+
         // Disconnect and stop
         void DisconnectAndStop();
 
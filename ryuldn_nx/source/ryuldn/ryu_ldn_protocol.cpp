@@ -9,6 +9,7 @@ namespace ams::mitm::ldn::ryuldn {
             _currentBuffer = nullptr;
         }
         _headerBytesReceived = 0;
+        _bufferStart = 0;
         _bufferEnd = 0;
         _inPacket = false;
     }
@@ -20,6 +21,7 @@ namespace ams::mitm::ldn::ryuldn {
         LOG_DBG_ARGS(COMP_RLDN_PROTOCOL," Read: Processing %d bytes (offset=%d)", size, offset);
         
         int index = 0;
+        bool invalid = false;
 
         while (index < size) {
             // Phase 1: Assemble header (10 bytes - sizeof(LdnHeader))
@@ -45,21 +47,21 @@ namespace ams::mitm::ldn::ryuldn {
                 if (header.magic != RyuLdnMagic) {
                     LOG_INFO_ARGS(COMP_RLDN_PROTOCOL, "RyuLdnProtocol: Invalid magic 0x%08x (expected 0x%08x)", 
                              header.magic, RyuLdnMagic);
-                    Reset();
-                    return;
+                    invalid = true;
+                    break;
                 }
 
                 if (header.version != ProtocolVersion) {
                     LOG_INFO_ARGS(COMP_RLDN_PROTOCOL, "RyuLdnProtocol: Invalid version %u (expected %u)", 
                              header.version, ProtocolVersion);
-                    Reset();
-                    return;
+                    invalid = true;
+                    break;
                 }
 
                 if (header.dataSize >= MaxPacketSize - HeaderSize) {
                     LOG_INFO_ARGS(COMP_RLDN_PROTOCOL, "RyuLdnProtocol: Packet too large (%d bytes)", header.dataSize);
-                    Reset();
-                    return;
+                    invalid = true;
+                    break;
                 }
 
                 // Special case: dataSize=0 means no payload, handle immediately
@@ -71,8 +73,17 @@ namespace ams::mitm::ldn::ryuldn {
                     continue;
                 }
 
-                // Borrow buffer for packet data
-                _currentBuffer = _pool->BorrowBuffer(TimeSpan::FromSeconds(5));
+                // Borrow buffer for packet data, or pack it after the frames this read already completed
+                if (_currentBuffer && static_cast<size_t>(_bufferStart) + header.dataSize > BufferPool::GetBufferSize()) {
+                    // Out of room: let the handlers finish with the earlier frames first
+                    if (onReadComplete) {
+                        onReadComplete();
+                    }
+                    _bufferStart = 0;
+                }
+                if (!_currentBuffer) {
+                    _currentBuffer = _pool->BorrowBuffer(TimeSpan::FromSeconds(5));
+                }
                 if (!_currentBuffer) {
                     LOG_INFO(COMP_RLDN_PROTOCOL, "RyuLdnProtocol: Failed to borrow buffer - dropping packet");
                     // Skip this packet's data
@@ -94,7 +105,7 @@ namespace ams::mitm::ldn::ryuldn {
                 int finalSize = header.dataSize;
                 int copyable = std::min(size - index, finalSize - _bufferEnd);
 
-                std::memcpy(_currentBuffer + _bufferEnd, data + index + offset, copyable);
+                std::memcpy(_currentBuffer + _bufferStart + _bufferEnd, data + index + offset, copyable);
 
                 index += copyable;
                 _bufferEnd += copyable;
@@ -102,12 +113,11 @@ namespace ams::mitm::ldn::ryuldn {
                 // Phase 4: Packet complete - decode and handle
                 if (_bufferEnd >= finalSize) {
                     LOG_DBG_ARGS(COMP_RLDN_PROTOCOL,"  Packet complete at index=%d, calling DecodeAndHandle", index);
-                    DecodeAndHandle(header, _currentBuffer);
-                    
-                    // Return buffer immediately
-                    _pool->ReturnBuffer(_currentBuffer);
-                    _currentBuffer = nullptr;
-                    
+                    DecodeAndHandle(header, _currentBuffer + _bufferStart);
+
+                    // Keep the frame until the read completes, the next one goes after it
+                    _bufferStart += finalSize;
+
                     // Reset for next packet
                     _headerBytesReceived = 0;
                     _bufferEnd = 0;
@@ -117,6 +127,25 @@ namespace ams::mitm::ldn::ryuldn {
             }
         }
         LOG_DBG_ARGS(COMP_RLDN_PROTOCOL," Read: Finished processing, index=%d size=%d", index, size);
+
+        if (onReadComplete) {
+            onReadComplete();
+        }
+
+        // Handlers are done with this read's frames: give the buffer back, or keep only the
+        // partial packet, moved to the front
+        if (invalid) {
+            Reset();
+        } else if (_inPacket) {
+            if (_bufferStart > 0) {
+                std::memmove(_currentBuffer, _currentBuffer + _bufferStart, _bufferEnd);
+                _bufferStart = 0;
+            }
+        } else if (_currentBuffer) {
+            _pool->ReturnBuffer(_currentBuffer);
+            _currentBuffer = nullptr;
+            _bufferStart = 0;
+        }
     }
 
     void RyuLdnProtocol::DecodeAndHandle(const LdnHeader& header, const u8* data) {
@@ -35,6 +35,7 @@ namespace ams::mitm::ldn::ryuldn {
     using ProxyConnectReplyCallback = std::function<void(const LdnHeader&, const ProxyConnectResponseFull&)>;
     using ProxyDataCallback = std::function<void(const LdnHeader&, const ProxyDataHeaderFull&, const u8*, u32)>;
     using ProxyDisconnectCallback = std::function<void(const LdnHeader&, const ProxyDisconnectMessageFull&)>;
+    using ReadCompleteCallback = std::function<void()>;
 
     /**
      * RyuLDN Protocol Handler
@@ -50,15 +51,20 @@ namespace ams::mitm::ldn::ryuldn {
      * - Behavior identical to original implementation
      */
     class RyuLdnProtocol {
-    private:
+    public:
+        // Every frame starts with an LdnHeader; EncodeHeader writes exactly this many bytes
         static constexpr int HeaderSize = sizeof(LdnHeader);
 
+    private:
+
         // Persistent header buffer (small - only 10 bytes for LdnHeader)
         u8 _headerBuffer[HeaderSize];
         int _headerBytesReceived;
         
-        // Borrowed buffer (returned after each packet)
+        // Borrowed buffer, kept for a whole Read(): frames completed by the read stay in it until
+        // onReadComplete, the packet being assembled starts at _bufferStart
         u8* _currentBuffer;
+        int _bufferStart;
         int _bufferEnd;
         
         BufferPool* _pool;
@@ -100,6 +106,7 @@ namespace ams::mitm::ldn::ryuldn {
         RyuLdnProtocol(BufferPool* pool)
             : _headerBytesReceived(0),
               _currentBuffer(nullptr),
+              _bufferStart(0),
               _bufferEnd(0),
               _pool(pool),
               _inPacket(false),
@@ -149,6 +156,10 @@ namespace ams::mitm::ldn::ryuldn {
         ProxyConnectReplyCallback onProxyConnectReply;
         ProxyDataCallback onProxyData;
         ProxyDisconnectCallback onProxyDisconnect;
+        // Called once at the end of every Read(), after all frames it completed were handled.
+        // Payload pointers handed to onProxyData stay valid until then (also called early if the
+        // read's frames outgrow the buffer)
+        ReadCompleteCallback onReadComplete;
 
         PingCallback onPing;
         NetworkErrorCallback onNetworkError;
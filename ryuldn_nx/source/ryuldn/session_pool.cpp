@@ -112,6 +112,16 @@ namespace ams::mitm::ldn::ryuldn::proxy {
                  _activeCount, MaxPooledSessions);
     }
 
+    void SessionPool::SignalStopAll() {
+        std::scoped_lock lk(_mutex);
+
+        for (size_t i = 0; i < MaxPooledSessions; i++) {
+            if (_sessions[i].inUse && _sessions[i].session != nullptr) {
+                _sessions[i].session->SignalStop();
+            }
+        }
+    }
+
     void SessionPool::Clear() {
         std::scoped_lock lk(_mutex);
 
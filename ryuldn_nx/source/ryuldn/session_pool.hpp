@@ -64,6 +64,12 @@ namespace ams::mitm::ldn::ryuldn::proxy {
          */
         size_t GetActiveCount() const { return _activeCount; }
 
+        /**
+         * Ask every active session to stop without joining
+         * Lets Clear() join threads that are already exiting instead of stopping them one by one
+         */
+        void SignalStopAll();
+
         /**
          * Clear all sessions (called on server shutdown)
          */
@@ -0,0 +1,212 @@
+#pragma once
+// Deadline queue for the networking threads
+// Lets a worker sleep exactly until its nearest deadline instead of waking on a fixed period
+
+#include <stratosphere.hpp>
+#include <functional>
+#include "wake_socket.hpp"
+
+namespace ams::mitm::ldn::ryuldn {
+
+    /**
+     * Timer queue shared by a worker thread and the threads arming its timers
+     *
+     * DESIGN:
+     * - Timers are registered once (fixed slots, no allocation) and then armed/disarmed
+     * - The owning worker asks for the time until the nearest deadline and sleeps that long
+     * - Arming a timer earlier than the current nearest deadline wakes the worker
+     *   (event for WaitForNextDeadline, optional WakeSocket for poll())
+     * - Expired callbacks run on the worker thread, outside of the queue lock
+     *
+     * The slot count is tiny, so the nearest deadline is found with a linear scan
+     * rather than a heap or wheel.
+     */
+    class TimerQueue {
+    public:
+        using TimerId = u32;
+        static constexpr TimerId InvalidTimerId = 0;
+        static constexpr size_t MaxTimers = 8;
+
+    private:
+        struct TimerSlot {
+            std::function<void()> callback;
+            u64 deadline;   // Absolute deadline in milliseconds (system tick based)
+            bool registered;
+            bool armed;
+        };
+
+        TimerSlot _slots[MaxTimers];
+        os::Mutex _mutex;
+        os::SystemEvent _wakeEvent;
+        WakeSocket* _wakeSocket;   // Optional: wakes a worker blocked in poll()
+
+        static u64 NowMs() {
+            return os::ConvertToTimeSpan(os::GetSystemTick()).GetMilliSeconds();
+        }
+
+        // Signalled under _mutex: AttachWakeSocket(nullptr) then returns only once no send() can still
+        // reach the socket, so its owner may close it right after detaching
+        void SignalWakeSocketLocked() {
+            if (_wakeSocket) {
+                _wakeSocket->Signal();
+            }
+        }
+
+        static size_t ToIndex(TimerId id) { return static_cast<size_t>(id) - 1; }
+
+        bool IsValid(TimerId id) const {
+            return id != InvalidTimerId && ToIndex(id) < MaxTimers && _slots[ToIndex(id)].registered;
+        }
+
+        // Caller must hold _mutex
+        bool FindNearestDeadline(u64* out) const {
+            bool found = false;
+            for (size_t i = 0; i < MaxTimers; i++) {
+                if (_slots[i].armed && (!found || _slots[i].deadline < *out)) {
+                    *out = _slots[i].deadline;
+                    found = true;
+                }
+            }
+            return found;
+        }
+
+    public:
+        TimerQueue()
+            : _slots{},
+              _mutex(false),
+              _wakeEvent(os::EventClearMode_AutoClear, false),
+              _wakeSocket(nullptr) {}
+
+        // No copy/move
+        TimerQueue(const TimerQueue&) = delete;
+        TimerQueue& operator=(const TimerQueue&) = delete;
+
+        /**
+         * Also signal this socket whenever the worker must re-evaluate its deadline
+         * Lets a worker sleeping in poll() use the nearest deadline as its only timeout
+         */
+        void AttachWakeSocket(WakeSocket* wakeSocket) {
+            std::scoped_lock lk(_mutex);
+            _wakeSocket = wakeSocket;
+        }
+
+        /**
+         * Register a timer callback
+         * Returns InvalidTimerId if all slots are in use
+         */
+        TimerId Register(std::function<void()> callback) {
+            std::scoped_lock lk(_mutex);
+            for (size_t i = 0; i < MaxTimers; i++) {
+                if (!_slots[i].registered) {
+                    _slots[i].callback = std::move(callback);
+                    _slots[i].deadline = 0;
+                    _slots[i].registered = true;
+                    _slots[i].armed = false;
+                    return static_cast<TimerId>(i + 1);
+                }
+            }
+            return InvalidTimerId;
+        }
+
+        void Unregister(TimerId id) {
+            std::scoped_lock lk(_mutex);
+            if (!IsValid(id)) {
+                return;
+            }
+            TimerSlot& slot = _slots[ToIndex(id)];
+            slot.callback = nullptr;
+            slot.registered = false;
+            slot.armed = false;
+        }
+
+        /**
+         * (Re)arm a timer to fire once after delayMs
+         * Wakes the worker if this is now the nearest deadline
+         */
+        void Arm(TimerId id, u64 delayMs) {
+            std::scoped_lock lk(_mutex);
+            if (!IsValid(id)) {
+                return;
+            }
+            const u64 deadline = NowMs() + delayMs;
+            u64 nearest = 0;
+            const bool wake = !FindNearestDeadline(&nearest) || deadline < nearest;
+
+            TimerSlot& slot = _slots[ToIndex(id)];
+            slot.deadline = deadline;
+            slot.armed = true;
+
+            if (wake) {
+                _wakeEvent.Signal();
+                SignalWakeSocketLocked();
+            }
+        }
+
+        void Disarm(TimerId id) {
+            std::scoped_lock lk(_mutex);
+            if (IsValid(id)) {
+                _slots[ToIndex(id)].armed = false;
+            }
+        }
+
+        /**
+         * Milliseconds until the nearest armed deadline
+         * Returns -1 if no timer is armed, 0 if a deadline already passed
+         */
+        s64 GetNextTimeoutMs() {
+            std::scoped_lock lk(_mutex);
+            u64 nearest = 0;
+            if (!FindNearestDeadline(&nearest)) {
+                return -1;
+            }
+            const u64 now = NowMs();
+            return nearest > now ? static_cast<s64>(nearest - now) : 0;
+        }
+
+        /**
+         * Block until the nearest deadline or until Wake()/Arm() signals the queue
+         */
+        void WaitForNextDeadline() {
+            const s64 timeoutMs = GetNextTimeoutMs();
+            if (timeoutMs < 0) {
+                _wakeEvent.Wait();
+            } else if (timeoutMs > 0) {
+                _wakeEvent.TimedWait(TimeSpan::FromMilliSeconds(timeoutMs));
+            }
+        }
+
+        /**
+         * Wake a thread blocked in WaitForNextDeadline (state change, shutdown)
+         */
+        void Wake() {
+            _wakeEvent.Signal();
+            std::scoped_lock lk(_mutex);
+            SignalWakeSocketLocked();
+        }
+
+        /**
+         * Fire every expired timer (one-shot: each is disarmed before its callback runs)
+         * Callbacks may re-arm their own timer
+         */
+        void RunExpired() {
+            std::function<void()> expired[MaxTimers];
+            size_t count = 0;
+            {
+                std::scoped_lock lk(_mutex);
+                const u64 now = NowMs();
+                for (size_t i = 0; i < MaxTimers; i++) {
+                    if (_slots[i].armed && _slots[i].deadline <= now) {
+                        _slots[i].armed = false;
+                        expired[count++] = _slots[i].callback;
+                    }
+                }
+            }
+            for (size_t i = 0; i < count; i++) {
+                if (expired[i]) {
+                    expired[i]();
+                }
+            }
+        }
+    };
+
+} // namespace ams::mitm::ldn::ryuldn
@@ -0,0 +1,85 @@
+#pragma once
+// Loopback wake socket
+// Lets a thread blocked in poll() on network sockets be woken immediately (self-pipe equivalent, bsd has no pipe)
+
+#include <stratosphere.hpp>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstring>
+
+namespace ams::mitm::ldn::ryuldn {
+
+    /**
+     * UDP socket bound to 127.0.0.1 and connected to itself
+     * Add GetFd() to a poll() set with POLLIN; Signal() makes it readable, Drain() resets it
+     */
+    class WakeSocket {
+    private:
+        s32 _socket;
+
+    public:
+        WakeSocket() : _socket(-1) {}
+        ~WakeSocket() { Close(); }
+
+        // No copy/move
+        WakeSocket(const WakeSocket&) = delete;
+        WakeSocket& operator=(const WakeSocket&) = delete;
+
+        bool Open() {
+            if (_socket >= 0) {
+                return true;
+            }
+
+            _socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+            if (_socket < 0) {
+                return false;
+            }
+
+            sockaddr_in addr;
+            std::memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = 0;
+
+            socklen_t addrLen = sizeof(addr);
+            if (::bind(_socket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+                ::getsockname(_socket, reinterpret_cast<sockaddr*>(&addr), &addrLen) < 0 ||
+                ::connect(_socket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+                Close();
+                return false;
+            }
+
+            int flags = ::fcntl(_socket, F_GETFL, 0);
+            ::fcntl(_socket, F_SETFL, flags | O_NONBLOCK);
+            return true;
+        }
+
+        void Close() {
+            if (_socket >= 0) {
+                ::close(_socket);
+                _socket = -1;
+            }
+        }
+
+        bool IsOpen() const { return _socket >= 0; }
+        s32 GetFd() const { return _socket; }
+
+        void Signal() {
+            if (_socket >= 0) {
+                u8 token = 0;
+                ::send(_socket, &token, sizeof(token), 0);
+            }
+        }
+
+        void Drain() {
+            if (_socket >= 0) {
+                u8 tokens[16];
+                while (::recv(_socket, tokens, sizeof(tokens), 0) > 0) {}
+            }
+        }
+    };
+
+} // namespace ams::mitm::ldn::ryuldn
@@ -1,5 +1,6 @@
 #include <cstring>
 #include <cstdio>
+#include <cstdlib>
 #include <cctype>
 #include <algorithm>
 #include "ryuldnnx_config.hpp"
@@ -29,7 +30,15 @@ RyuLdnConfig LdnConfig::config = {
 std::atomic_bool LdnConfig::enabled = true;
 std::atomic_bool LdnConfig::logging_enabled = false;  // Default logging disabled
 std::atomic_uint32_t LdnConfig::logging_level = 1;    // Default level 1
+std::atomic_uint32_t LdnConfig::scan_cache_ms = 1000;  // Default 1s freshness window
+std::atomic_uint32_t LdnConfig::socket_pool_size = 4;  // Default 4 pooled virtual sockets
+std::atomic_bool LdnConfig::tcp_optimistic_connect = false;  // Default: wait for the peer's reply
+std::atomic_uint32_t LdnConfig::slow_consumer_ms = 500;  // Default 500ms above half the receive limit
+u64 LdnConfig::bsd_mitm_titles[LdnConfig::MaxBsdMitmTitles] = {};
+std::atomic_uint32_t LdnConfig::bsd_mitm_title_count = 0;
 std::function<void(const char*, u32)> LdnConfig::PassphraseUpdateHandler{};
+std::function<size_t(RyuLdnSocketStats*, size_t)> LdnConfig::SocketStatsHandler{};
+os::SdkMutex LdnConfig::socket_stats_mutex;
 
 // Load config from ini file
 void LdnConfig::LoadConfigFromIni() {
@@ -60,11 +69,17 @@ void LdnConfig::LoadConfigFromIni() {
     (void)ams::fs::ReadFile(&read_sz, fh, 0, content.data(), content.size(), ams::fs::ReadOption::None);
     ams::fs::CloseFile(fh);
 
-    // Parse ini file - custom_host, custom_port, logging_enabled, logging_level
+    // Parse ini file - custom_host, custom_port, logging_enabled, logging_level, scan_cache_ms, socket_pool_size,
+    // tcp_optimistic_connect, slow_consumer_ms, bsd_mitm_titles
     std::string custom_host{};
     int custom_port = 30456;
     bool log_enabled = false;
     int log_level = 3;  // INFO par défaut
+    int scan_cache = static_cast<int>(scan_cache_ms.load());
+    int pool_size = static_cast<int>(socket_pool_size.load());
+    bool optimistic_connect = tcp_optimistic_connect.load();
+    int slow_consumer = static_cast<int>(slow_consumer_ms.load());
+    u32 title_count = 0;
 
     std::string entry;
     entry.reserve(256);
@@ -105,6 +120,40 @@ void LdnConfig::LoadConfigFromIni() {
                     if (lvl >= 1 && lvl <= 5) {
                         log_level = lvl;
                     }
+                } else if (key == "scan_cache_ms") {
+                    int ms = std::atoi(value.c_str());
+                    if (ms >= 0 && ms <= 60000) {
+                        scan_cache = ms;
+                    }
+                } else if (key == "socket_pool_size") {
+                    int size = std::atoi(value.c_str());
+                    if (size >= 0 && size <= 32) {
+                        pool_size = size;
+                    }
+                } else if (key == "tcp_optimistic_connect") {
+                    optimistic_connect = (value == "true" || value == "1");
+                } else if (key == "slow_consumer_ms") {
+                    int ms = std::atoi(value.c_str());
+                    if (ms >= 0 && ms <= 60000) {
+                        slow_consumer = ms;
+                    }
+                } else if (key == "bsd_mitm_titles") {
+                    // Comma separated program ids (hex), e.g. 0100000000010000,01006F8002326000
+                    const char* p = value.c_str();
+                    while (*p != '\0' && title_count < MaxBsdMitmTitles) {
+                        char* end = nullptr;
+                        const u64 program_id = std::strtoull(p, &end, 16);
+                        if (end == p) {
+                            break;
+                        }
+                        if (program_id != 0) {
+                            bsd_mitm_titles[title_count++] = program_id;
+                        }
+                        p = end;
+                        while (*p == ',' || *p == ' ') {
+                            p++;
+                        }
+                    }
                 }
             }
         }
@@ -122,6 +171,12 @@ void LdnConfig::LoadConfigFromIni() {
     logging_enabled = log_enabled;
     logging_level = log_level;
     ams::log::gLogLevel.store(log_level, std::memory_order_relaxed);
+
+    scan_cache_ms = scan_cache;
+    socket_pool_size = pool_size;
+    tcp_optimistic_connect = optimistic_connect;
+    slow_consumer_ms = slow_consumer;
+    bsd_mitm_title_count = title_count;
 }
 
 // Save config to ini file
@@ -135,7 +190,7 @@ void LdnConfig::SaveConfigToIni() {
         ams::fs::CreateDirectory(kIniDir);
     }
 
-    // Build ini content - IP, port, and logging settings
+    // Build ini content - IP, port, logging and scan cache settings
     std::string content;
     content += "custom_host = ";
     content += (strlen(config.server_ip) > 0) ? config.server_ip : "0.0.0.0";
@@ -149,6 +204,25 @@ void LdnConfig::SaveConfigToIni() {
     content += "logging_level = ";
     content += std::to_string(logging_level.load());
     content += "\n";
+    content += "scan_cache_ms = ";
+    content += std::to_string(scan_cache_ms.load());
+    content += "\n";
+    content += "socket_pool_size = ";
+    content += std::to_string(socket_pool_size.load());
+    content += "\n";
+    content += "tcp_optimistic_connect = ";
+    content += tcp_optimistic_connect ? "true" : "false";
+    content += "\n";
+    content += "slow_consumer_ms = ";
+    content += std::to_string(slow_consumer_ms.load());
+    content += "\n";
+    content += "bsd_mitm_titles = ";
+    for (u32 i = 0; i < bsd_mitm_title_count.load(); i++) {
+        char title[24];
+        std::snprintf(title, sizeof(title), "%s%016lX", i > 0 ? "," : "", bsd_mitm_titles[i]);
+        content += title;
+    }
+    content += "\n";
 
     // Write to file
     ams::fs::DeleteFile(kIniPath); // Delete old file
@@ -256,10 +330,23 @@ Result LdnConfig::SetLoggingLevel(u32 level) {
     R_SUCCEED();
 }
 
+// Get per virtual socket traffic counters (cmd 65014)
+Result LdnConfig::GetSocketStats(sf::Out<u32> count, sf::OutArray<RyuLdnSocketStats> stats) {
+    std::scoped_lock lk(socket_stats_mutex);
+    const size_t filled = SocketStatsHandler ? SocketStatsHandler(stats.GetPointer(), stats.GetSize()) : 0;
+    count.SetValue(static_cast<u32>(filled));
+    R_SUCCEED();
+}
+
 void LdnConfig::SetPassphraseUpdateHandler(std::function<void(const char*, u32)> handler) {
     PassphraseUpdateHandler = std::move(handler);
 }
 
+void LdnConfig::SetSocketStatsHandler(std::function<size_t(RyuLdnSocketStats*, size_t)> handler) {
+    std::scoped_lock lk(socket_stats_mutex);
+    SocketStatsHandler = std::move(handler);
+}
+
 // Runtime accessors
 bool LdnConfig::IsLoggingEnabled() {
     return logging_enabled.load();
@@ -269,5 +356,15 @@ u32 LdnConfig::GetLoggingLevelValue() {
     return logging_level.load();
 }
 
+bool LdnConfig::IsBsdMitmTitle(u64 program_id) {
+    const u32 count = bsd_mitm_title_count.load();
+    for (u32 i = 0; i < count; i++) {
+        if (bsd_mitm_titles[i] == program_id) {
+            return true;
+        }
+    }
+    return false;
+}
+
 } // namespace ams::mitm::ldn
 
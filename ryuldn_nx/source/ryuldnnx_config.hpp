@@ -15,6 +15,19 @@ private:
     static std::atomic_bool enabled;
     static std::atomic_bool logging_enabled;
     static std::atomic_uint32_t logging_level;  // 1-5
+    static std::atomic_uint32_t scan_cache_ms;  // Scan result freshness window, 0 = disabled
+    static std::atomic_uint32_t socket_pool_size;  // Idle virtual sockets kept for reuse, 0 = no pooling
+    static std::atomic_bool tcp_optimistic_connect;  // Virtual TCP connect returns before the peer's reply
+    static std::atomic_uint32_t slow_consumer_ms;  // Receive queue high for this long flags a socket, 0 = never
+
+    // Fills the socket stats snapshot; set while a proxy is active
+    static std::function<size_t(RyuLdnSocketStats*, size_t)> SocketStatsHandler;
+    static os::SdkMutex socket_stats_mutex;
+
+    // Titles whose bsd:u sessions are always mitm'd, even without an ldn:u session
+    static constexpr size_t MaxBsdMitmTitles = 16;
+    static u64 bsd_mitm_titles[MaxBsdMitmTitles];
+    static std::atomic_uint32_t bsd_mitm_title_count;
     
     // Helper functions for ini file management
     static void LoadConfigFromIni();
@@ -35,10 +48,16 @@ public:
     Result SetServerPort(u16 port);
     Result GetLoggingLevel(sf::Out<u32> level);
     Result SetLoggingLevel(u32 level);
+    Result GetSocketStats(sf::Out<u32> count, sf::OutArray<RyuLdnSocketStats> stats);
 
     // Runtime accessors for logging state
     static bool IsLoggingEnabled();
     static u32 GetLoggingLevelValue();
+    static u32 GetScanCacheMs() { return scan_cache_ms.load(); }
+    static u32 GetSocketPoolSize() { return socket_pool_size.load(); }
+    static bool IsTcpOptimisticConnect() { return tcp_optimistic_connect.load(); }
+    static u32 GetSlowConsumerMs() { return slow_consumer_ms.load(); }
+    static bool IsBsdMitmTitle(u64 program_id);
 
     // Internal accessors
     static bool IsEnabled() { return enabled; }
@@ -52,6 +71,8 @@ public:
     static u32 getPassphraseSize() { return strlen(config.passphrase); }
 
     static void SetPassphraseUpdateHandler(std::function<void(const char*, u32)> handler);
+    // Clearing it waits for a snapshot in progress, so the proxy can be deleted right after
+    static void SetSocketStatsHandler(std::function<size_t(RyuLdnSocketStats*, size_t)> handler);
     
     // Initialize config from ini file
     static void Initialize();
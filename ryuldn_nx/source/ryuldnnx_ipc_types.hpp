@@ -35,6 +35,26 @@ struct RyuLdnStatus {
     int64_t ping_ms;
 };
 
+// Traffic counters of one virtual socket (GetSocketStats snapshot); addresses in host byte order
+struct RyuLdnSocketStats {
+    uint32_t local_ip;
+    uint16_t local_port;
+    uint8_t protocol;            // IPPROTO_TCP / IPPROTO_UDP
+    uint8_t slow_consumer;       // Receive queue stayed over half its limit for slow_consumer_ms
+    uint32_t remote_ip;          // 0 unless connected
+    uint16_t remote_port;
+    uint16_t _reserved;
+    uint64_t packets_in;
+    uint64_t bytes_in;
+    uint64_t packets_out;
+    uint64_t bytes_out;
+    uint32_t queue_bytes;
+    uint32_t queue_high_water;
+    uint32_t receive_drops;
+    uint32_t backlog_drops;
+    int64_t ms_since_last_read;  // -1 = never read
+};
+
 // Configuration payload
 struct RyuLdnConfig {
     uint32_t enabled;  // 0=disabled, 1=enabled